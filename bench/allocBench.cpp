@@ -0,0 +1,170 @@
+// Counts heap allocations per login round trip (parse request, fill reply, serialize it into the outbound
+// payload) for the ways the server has built its messages:
+//   plain:      messages on the stack, header copied in, reply serialized into a string (original handlers)
+//   arena:      request and reply on a reused per-thread arena that is reset afterwards (registerHandler)
+//   call arena: request and reply on an arena allocated with its first block per call (registerAsyncHandler)
+// The arena variants only save allocations with generated code that is arena-constructable: the checked-in
+// sources predate cc_enable_arenas, so until complie_proto_file.sh is rerun their fields stay on the heap.
+//
+// usage: allocBench [iterations]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <google/protobuf/arena.h>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "msg.pb.h"
+#include "msg_header.pb.h"
+
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+static int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static void FillLoginResponse(msg::LoginResponse &loginResp)
+{
+    loginResp.mutable_header()->set_timestamp(Now());
+    loginResp.set_state(msg::LoginResponse::USER_VERIFICATION_SUCCESS);
+    loginResp.set_session_id("session_abc123");
+}
+
+static std::shared_ptr<std::string> Serialize(const msg::LoginResponse &loginResp)
+{
+    auto payload = std::make_shared<std::string>(loginResp.ByteSizeLong(), '\0');
+    loginResp.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t *>(&(*payload)[0]));
+    return payload;
+}
+
+static size_t PlainRoundTrip(const std::string &wire)
+{
+    msg::LoginRequest loginReq;
+    loginReq.ParseFromString(wire);
+
+    msg_header::ServerMsgHeader header;
+    header.set_timestamp(Now());
+    msg::LoginResponse loginResp;
+    loginResp.mutable_header()->CopyFrom(header);
+    loginResp.set_state(msg::LoginResponse::USER_VERIFICATION_SUCCESS);
+    loginResp.set_session_id("session_abc123");
+
+    std::string msg;
+    loginResp.SerializeToString(&msg);
+    return std::make_shared<std::string>(std::move(msg))->size();
+}
+
+static size_t ArenaRoundTrip(const std::string &wire)
+{
+    // Same setup as NetworkManager::requestArena()
+    thread_local char                    initialBlock[8 * 1024];
+    thread_local google::protobuf::Arena arena([] {
+        google::protobuf::ArenaOptions options;
+        options.initial_block      = initialBlock;
+        options.initial_block_size = sizeof(initialBlock);
+        return options;
+    }());
+
+    auto *loginReq  = google::protobuf::Arena::Create<msg::LoginRequest>(&arena);
+    auto *loginResp = google::protobuf::Arena::Create<msg::LoginResponse>(&arena);
+    loginReq->ParseFromString(wire);
+    FillLoginResponse(*loginResp);
+    size_t size = Serialize(*loginResp)->size();
+    arena.Reset();
+    return size;
+}
+
+static size_t CallArenaRoundTrip(const std::string &wire)
+{
+    // Same layout as the arena part of NetworkManager::AsyncRequest
+    struct CallArena
+    {
+        alignas(std::max_align_t) char initialBlock[1024];
+        google::protobuf::Arena        arena;
+
+        CallArena()
+            : arena([this] {
+                  google::protobuf::ArenaOptions options;
+                  options.initial_block      = initialBlock;
+                  options.initial_block_size = sizeof(initialBlock);
+                  return options;
+              }())
+        {
+        }
+    };
+
+    auto  call      = std::make_shared<CallArena>();
+    auto *loginReq  = google::protobuf::Arena::Create<msg::LoginRequest>(&call->arena);
+    auto *loginResp = google::protobuf::Arena::Create<msg::LoginResponse>(&call->arena);
+    loginReq->ParseFromString(wire);
+    FillLoginResponse(*loginResp);
+    return Serialize(*loginResp)->size();
+}
+
+template <typename F> static void Run(const char *name, const std::string &wire, size_t iterations, F roundTrip)
+{
+    // Warm up thread_local state and protobuf's default instances first
+    roundTrip(wire);
+
+    size_t before = g_allocations.load();
+    auto   start  = std::chrono::steady_clock::now();
+    size_t bytes  = 0;
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        bytes += roundTrip(wire);
+    }
+    auto   elapsed = std::chrono::steady_clock::now() - start;
+    size_t count   = g_allocations.load() - before;
+
+    std::printf("%-12s %6.2f allocations/request %8.1f ns/request (%zu reply bytes)\n", name,
+                static_cast<double>(count) / iterations,
+                std::chrono::duration<double, std::nano>(elapsed).count() / iterations, bytes / iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    // Short fields fit the string's inline buffer, long ones need a heap buffer of their own
+    for (size_t fieldLength : {8, 40})
+    {
+        msg::LoginRequest loginReq;
+        loginReq.mutable_header()->set_session_id(std::string(fieldLength, 's'));
+        loginReq.mutable_header()->set_timestamp(Now());
+        loginReq.set_username(std::string(fieldLength, 'u'));
+        loginReq.set_password(std::string(fieldLength, 'p'));
+        std::string wire;
+        loginReq.SerializeToString(&wire);
+
+        std::printf("fields of %zu bytes:\n", fieldLength);
+        Run("plain", wire, iterations, PlainRoundTrip);
+        Run("arena", wire, iterations, ArenaRoundTrip);
+        Run("call arena", wire, iterations, CallArenaRoundTrip);
+    }
+    return 0;
+}
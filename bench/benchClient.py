@@ -0,0 +1,87 @@
+"""Frame helpers shared by the load scripts in this directory.
+
+A frame on the wire is a big-endian u16 message type and u32 body length, then the body.
+"""
+
+import os
+import resource
+import socket
+import struct
+
+HEARTBEAT = 1
+LOGIN_REQUEST = 4
+LOGIN_RESPONSE = 5
+
+HEADER = struct.Struct('!HI')
+
+
+def frame(msg_type, body=b''):
+    return HEADER.pack(msg_type, len(body)) + body
+
+
+def login_request(username, password):
+    """LoginRequest with username (field 2) and password (field 3) set, short strings only."""
+    body = b''
+    for tag, value in ((0x12, username.encode()), (0x1a, password.encode())):
+        body += bytes([tag, len(value)]) + value
+    return frame(LOGIN_REQUEST, body)
+
+
+def read_frame(sock):
+    """Blocks until one whole frame arrived, returns (type, body) or None once the server closed."""
+    header = read_exactly(sock, HEADER.size)
+    if header is None:
+        return None
+    msg_type, length = HEADER.unpack(header)
+    body = read_exactly(sock, length)
+    return None if body is None else (msg_type, body)
+
+
+def read_exactly(sock, size):
+    data = b''
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def source_address(index, per_address):
+    """Spread clients over 127.0.0.0/8 so the per-address connection rate limit does not refuse them."""
+    host = 2 + index // per_address
+    return '127.%d.%d.%d' % (host >> 16 & 0xff, host >> 8 & 0xff, host & 0xff)
+
+
+def connect(port, index=0, per_address=32, host='127.0.0.1'):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    if host.startswith('127.'):
+        sock.bind((source_address(index, per_address), 0))
+    sock.connect((host, port))
+    return sock
+
+
+def raise_fd_limit():
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+    return hard
+
+
+def rss_kib(pid):
+    with open('/proc/%d/status' % pid) as status:
+        for line in status:
+            if line.startswith('VmRSS:'):
+                return int(line.split()[1])
+    raise RuntimeError('no VmRSS for pid %d' % pid)
+
+
+def cpu_seconds(pid):
+    """User plus system CPU time the process has used so far."""
+    with open('/proc/%d/stat' % pid) as stat:
+        fields = stat.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+
+def percentile(sorted_values, fraction):
+    return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * fraction))]
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Connection storm: how fast the server takes on a burst of new connections.
+
+Starts N non-blocking connects at once, like clients reconnecting after a deploy, and sends a heartbeat
+ping on each as soon as it is connected. A connection counts once its pong is back, so the rate covers
+accepting it and serving its first message. Clients are spread over 127.0.0.0/8 source addresses, so the
+default connection rate limit admits them. The listen backlog (net.core.somaxconn) caps how many connects
+the kernel queues for the server at once. Given the server's pid, it also reports the server CPU time per
+connection, which does not depend on how fast this script can open them.
+
+usage: connectStorm.py [--connections 10000] [--port 7777] [--timeout 30] [--pid SERVER_PID]
+"""
+
+import argparse
+import errno
+import select
+import socket
+import time
+
+import benchClient
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--connections', type=int, default=10000)
+    parser.add_argument('--port', type=int, default=7777)
+    parser.add_argument('--timeout', type=float, default=30, help='seconds to wait for all pongs')
+    parser.add_argument('--pid', type=int, help='pid of the running server, to report its CPU time')
+    args = parser.parse_args()
+
+    limit = benchClient.raise_fd_limit()
+    if args.connections + 64 > limit:
+        raise SystemExit('fd limit %d is too low for %d connections' % (limit, args.connections))
+
+    ping   = benchClient.frame(benchClient.HEARTBEAT, b'ping')
+    pong   = benchClient.frame(benchClient.HEARTBEAT, b'pong')
+    poller = select.epoll()
+    socks  = {}
+    cpu    = benchClient.cpu_seconds(args.pid) if args.pid else 0
+    start  = time.perf_counter()
+    for i in range(args.connections):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.setblocking(False)
+        sock.bind((benchClient.source_address(i, 32), 0))
+        result = sock.connect_ex(('127.0.0.1', args.port))
+        if result not in (0, errno.EINPROGRESS):
+            raise SystemExit('connect %d failed: %s' % (i, errno.errorcode.get(result, result)))
+        socks[sock.fileno()] = [sock, b'']
+        poller.register(sock.fileno(), select.EPOLLOUT)
+
+    # A socket is writable once connected, then waits for its pong
+    answered = 0
+    failed   = 0
+    latest   = start
+    deadline = start + args.timeout
+    while answered + failed < args.connections and time.perf_counter() < deadline:
+        for fd, events in poller.poll(0.1):
+            sock, received = socks[fd]
+            if events & select.EPOLLOUT:
+                sock.send(ping)
+                poller.modify(fd, select.EPOLLIN)
+                continue
+            try:
+                chunk = sock.recv(len(pong) - len(received))
+            except OSError:
+                chunk = b''
+            if not chunk:
+                failed += 1
+                poller.unregister(fd)
+                continue
+            socks[fd][1] = received = received + chunk
+            if len(received) == len(pong):
+                answered += 1
+                latest = time.perf_counter()
+                poller.unregister(fd)
+
+    elapsed = latest - start
+    print('%d of %d connections answered in %.2fs, %d failed: %.0f connections/s'
+          % (answered, args.connections, elapsed, failed, answered / max(elapsed, 1e-9)))
+    if args.pid:
+        cpu = benchClient.cpu_seconds(args.pid) - cpu
+        print('server CPU %.3fs: %.1f us per connection' % (cpu, cpu * 1e6 / max(answered, 1)))
+    for sock, _ in socks.values():
+        sock.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Idle connection soak: server RSS per idle connection, and what trimConnectionPool gives back.
+
+Opens N idle loopback connections and reports the server's RSS per connection. Then it closes them and
+waits for the reactors' periodic trimConnectionPool before it reports the RSS again. Clients are spread
+over 127.0.0.0/8 source addresses, so the default connection rate limit admits them. The server has to
+allow N file descriptors (ulimit -n), and so does this script, which raises its own soft limit.
+
+usage: idleSoak.py SERVER_PID [--connections 100000] [--port 7777] [--trim-wait 12]
+"""
+
+import argparse
+import select
+import time
+
+import benchClient
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('pid', type=int, help='pid of the running server')
+    parser.add_argument('--connections', type=int, default=100000)
+    parser.add_argument('--port', type=int, default=7777)
+    parser.add_argument('--trim-wait', type=float, default=12, help='seconds to wait for the pool trim')
+    args = parser.parse_args()
+
+    limit = benchClient.raise_fd_limit()
+    if args.connections + 64 > limit:
+        raise SystemExit('fd limit %d is too low for %d connections' % (limit, args.connections))
+
+    baseline = benchClient.rss_kib(args.pid)
+    start = time.time()
+    socks = [benchClient.connect(args.port, i) for i in range(args.connections)]
+    time.sleep(1)
+
+    # A rate limited or refused connection is closed by the server at once and reads as EOF
+    poller = select.epoll()
+    for sock in socks:
+        poller.register(sock.fileno(), select.EPOLLIN | select.EPOLLRDHUP)
+    refused = len(poller.poll(0, len(socks)))
+    poller.close()
+
+    loaded = benchClient.rss_kib(args.pid)
+    opened = len(socks) - refused
+    print('%d idle connections open after %.1fs, %d refused' % (opened, time.time() - start, refused))
+    print('server RSS %d KiB idle, %d KiB with connections: %.0f bytes per connection'
+          % (baseline, loaded, (loaded - baseline) * 1024.0 / max(1, opened)))
+
+    for sock in socks:
+        sock.close()
+    time.sleep(args.trim_wait)
+    trimmed = benchClient.rss_kib(args.pid)
+    print('server RSS %d KiB %.0fs after closing them, %d KiB above idle'
+          % (trimmed, args.trim_wait, trimmed - baseline))
+
+
+if __name__ == '__main__':
+    main()
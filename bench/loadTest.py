@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Steady request load: replies per second over many connections, to compare the I/O backends.
+
+Opens C connections and keeps D heartbeat pings in flight on each, sending a new one for every pong that
+comes back. Pings are answered on the reactor, so the figures are the reactors' I/O path without any
+handler work. Run it once against an epoll server and once against SECURETALK_IO_BACKEND=io_uring. Given
+the server's pid, it also reports the server CPU time per reply.
+
+usage: loadTest.py [--connections 200] [--depth 8] [--duration 10] [--port 7777] [--pid SERVER_PID]
+"""
+
+import argparse
+import select
+import time
+
+import benchClient
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--connections', type=int, default=200)
+    parser.add_argument('--depth', type=int, default=8, help='pings in flight per connection')
+    parser.add_argument('--duration', type=float, default=10, help='seconds to measure')
+    parser.add_argument('--port', type=int, default=7777)
+    parser.add_argument('--pid', type=int, help='pid of the running server, to report its CPU time')
+    args = parser.parse_args()
+
+    benchClient.raise_fd_limit()
+    ping   = benchClient.frame(benchClient.HEARTBEAT, b'ping')
+    pong   = len(benchClient.frame(benchClient.HEARTBEAT, b'pong'))
+    poller = select.epoll()
+    socks  = {}
+    for i in range(args.connections):
+        sock = benchClient.connect(args.port, i)
+        sock.setblocking(False)
+        socks[sock.fileno()] = [sock, 0]
+        poller.register(sock.fileno(), select.EPOLLIN)
+        sock.send(ping * args.depth)
+
+    # Replies are all the same size, so counting bytes is enough to count them
+    replies = 0
+    cpu     = benchClient.cpu_seconds(args.pid) if args.pid else 0
+    start   = time.perf_counter()
+    end     = start + args.duration
+    while time.perf_counter() < end:
+        for fd, _ in poller.poll(0.1):
+            entry = socks[fd]
+            chunk = entry[0].recv(65536)
+            if not chunk:
+                raise SystemExit('server closed a connection')
+            entry[1] += len(chunk)
+            answered  = entry[1] // pong
+            entry[1] -= answered * pong
+            replies  += answered
+            if answered:
+                entry[0].send(ping * answered)
+    elapsed = time.perf_counter() - start
+
+    print('%d connections, %d in flight each: %.0f replies/s' % (args.connections, args.depth, replies / elapsed))
+    if args.pid:
+        cpu = benchClient.cpu_seconds(args.pid) - cpu
+        print('server CPU %.2fs: %.2f us per reply' % (cpu, cpu * 1e6 / max(replies, 1)))
+    for sock, _ in socks.values():
+        sock.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""Login round-trip latency on an otherwise idle server.
+
+Sends one login request at a time and waits for its reply. It pauses between requests, so the reactors
+are idle in their event wait whenever a reply is queued by a worker. Reports p50, p99 and max of the round
+trips. The credentials do not need to exist, a failed login is answered just the same.
+
+Logins are rate limited per peer address (5/s, burst 10 by default), so the requests take turns over
+connections from different 127.0.0.0/8 source addresses. Each address stays under the limit as long as
+connections * pause is at least 0.2 seconds.
+
+usage: loginLatency.py [--requests 200] [--pause 0.02] [--connections 20] [--port 7777]
+"""
+
+import argparse
+import time
+
+import benchClient
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--requests', type=int, default=200)
+    parser.add_argument('--pause', type=float, default=0.02, help='idle seconds between requests')
+    parser.add_argument('--connections', type=int, default=20, help='source addresses taking turns')
+    parser.add_argument('--port', type=int, default=7777)
+    args = parser.parse_args()
+
+    socks     = [benchClient.connect(args.port, i, per_address=1) for i in range(args.connections)]
+    request   = benchClient.login_request('latency', 'latency')
+    latencies = []
+    for i in range(args.requests):
+        sock = socks[i % len(socks)]
+        time.sleep(args.pause)
+        start = time.perf_counter()
+        sock.sendall(request)
+        reply = benchClient.read_frame(sock)
+        if reply is None or reply[0] != benchClient.LOGIN_RESPONSE:
+            raise SystemExit('unexpected reply %r' % (reply,))
+        latencies.append((time.perf_counter() - start) * 1000)
+
+    latencies.sort()
+    print('%d logins: p50 %.2f ms, p99 %.2f ms, max %.2f ms'
+          % (len(latencies), benchClient.percentile(latencies, 0.5), benchClient.percentile(latencies, 0.99),
+             latencies[-1]))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,60 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "networkMsg.h"
+
+// CoDel-style overload detector for the worker queue. Workers report how long each message waited,
+// once the wait stays above target for a whole interval the shed level rises by one, and again after
+// every further interval above target. Messages whose priority is below the shed level are rejected
+// both before they are queued and when they are dequeued. Waits are tracked per priority, since the
+// workers serve higher ones first: the overload ends once no priority has waited above target within
+// the last interval, or the queue drains.
+class AdmissionControl
+{
+  public:
+    AdmissionControl(std::chrono::microseconds target = std::chrono::milliseconds(5),
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(100), uint8_t maxLevel = 3,
+                     size_t maxQueueDepth = 100000);
+
+    // Only safe before messages flow
+    void configure(std::chrono::microseconds target, std::chrono::milliseconds interval, size_t maxQueueDepth);
+
+    // Whether a message of this priority may be queued or handled, counts it as shed otherwise
+    bool admit(uint8_t priority, size_t queueDepth);
+
+    // Worker side: report the queueing delay of a message taken off the queue
+    void onDequeue(uint8_t priority, std::chrono::steady_clock::duration sojourn, size_t queueDepth,
+                   std::chrono::steady_clock::time_point now);
+
+    uint8_t shedLevel() const
+    {
+        return m_shedLevel.load(std::memory_order_relaxed);
+    }
+    uint64_t shedCount() const
+    {
+        return m_shedCount.load(std::memory_order_relaxed);
+    }
+
+  private:
+    void recover();
+
+  private:
+    std::chrono::steady_clock::duration m_target;
+    std::chrono::steady_clock::duration m_interval;
+    uint8_t                             m_maxLevel;
+    size_t                              m_maxQueueDepth;
+
+    std::atomic<int64_t>  m_escalateAt{0}; // Raise the level at this time if waits stay above target, 0 if below
+    std::atomic<uint8_t>  m_shedLevel{0};
+    std::atomic<uint64_t> m_shedCount{0};
+    // Per priority: end of the interval after its last wait above target, 0 once one was below
+    std::array<std::atomic<int64_t>, kPriorityCount> m_slowUntil{};
+};
+
+#endif // ADMISSION_CONTROL_H
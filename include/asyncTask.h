@@ -0,0 +1,206 @@
+#ifndef ASYNC_TASK_H
+#define ASYNC_TASK_H
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "executor.h"
+#include "logManager.h"
+
+// Hands the co_returned value to onReturn, a void task only reports that it finished
+template <typename T> struct AsyncTaskReturn
+{
+    using OnReturn = std::function<void(T &)>;
+    OnReturn onReturn;
+
+    void return_value(T value)
+    {
+        if (onReturn)
+        {
+            onReturn(value);
+        }
+    }
+};
+
+template <> struct AsyncTaskReturn<void>
+{
+    using OnReturn = std::function<void()>;
+    OnReturn onReturn;
+
+    void return_void()
+    {
+        if (onReturn)
+        {
+            onReturn();
+        }
+    }
+};
+
+// Coroutine returned by async message handlers. It starts suspended: the framework first sets where it
+// continues after an await and what happens when it returns, then starts it. The frame frees itself when
+// the coroutine finishes, the promise and its callbacks last.
+template <typename T> class AsyncTask
+{
+  public:
+    struct promise_type : AsyncTaskReturn<T>
+    {
+        std::function<void(std::coroutine_handle<>)> resumeOn; // Schedules the coroutine once an await is done
+
+        AsyncTask get_return_object()
+        {
+            return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void unhandled_exception()
+        {
+            try
+            {
+                std::rethrow_exception(std::current_exception());
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERROR(networkLogger, "Async handler failed: " + std::string(e.what()));
+            }
+            catch (...)
+            {
+                LOG_ERROR(networkLogger, "Async handler failed");
+            }
+        }
+    };
+
+  public:
+    AsyncTask(AsyncTask &&other) noexcept : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+    ~AsyncTask()
+    {
+        // Only a task that was never started still owns its frame
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    void start(std::function<void(std::coroutine_handle<>)> resumeOn, typename AsyncTaskReturn<T>::OnReturn onReturn)
+    {
+        std::coroutine_handle<promise_type> handle = std::exchange(m_handle, {});
+        handle.promise().resumeOn                 = std::move(resumeOn);
+        handle.promise().onReturn                 = std::move(onReturn);
+        handle.resume();
+    }
+
+  private:
+    explicit AsyncTask(std::coroutine_handle<promise_type> handle) : m_handle(handle)
+    {
+    }
+
+  private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// co_await runOn(executor, fn): runs fn on the executor, the coroutine continues with its result
+template <typename F> class ExecutorAwaitable
+{
+  public:
+    using Result = std::invoke_result_t<F &>;
+
+  public:
+    ExecutorAwaitable(Executor &executor, F fn) : m_executor(executor), m_fn(std::move(fn))
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+    template <typename Promise> void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        // The coroutine may be resumed before post() returns, nothing may touch it after that
+        m_executor.post([this, handle]() {
+            try
+            {
+                if constexpr (std::is_void_v<Result>)
+                {
+                    m_fn();
+                }
+                else
+                {
+                    m_result.emplace(m_fn());
+                }
+            }
+            catch (...)
+            {
+                m_exception = std::current_exception();
+            }
+            handle.promise().resumeOn(handle);
+        });
+    }
+    Result await_resume()
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+        if constexpr (!std::is_void_v<Result>)
+        {
+            return std::move(*m_result);
+        }
+    }
+
+  private:
+    using Storage = std::conditional_t<std::is_void_v<Result>, char, Result>;
+
+    Executor              &m_executor;
+    F                      m_fn;
+    std::optional<Storage> m_result;
+    std::exception_ptr     m_exception;
+};
+
+template <typename F> ExecutorAwaitable<F> runOn(Executor &executor, F fn)
+{
+    return ExecutorAwaitable<F>(executor, std::move(fn));
+}
+
+// co_await sleepFor(duration): suspends without holding a thread
+class SleepAwaitable
+{
+  public:
+    explicit SleepAwaitable(std::chrono::steady_clock::duration duration) : m_duration(duration)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return m_duration <= std::chrono::steady_clock::duration::zero();
+    }
+    template <typename Promise> void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        Executor::timer()->postAt(std::chrono::steady_clock::now() + m_duration,
+                                  [handle]() { handle.promise().resumeOn(handle); });
+    }
+    void await_resume() const noexcept
+    {
+    }
+
+  private:
+    std::chrono::steady_clock::duration m_duration;
+};
+
+inline SleepAwaitable sleepFor(std::chrono::steady_clock::duration duration)
+{
+    return SleepAwaitable(duration);
+}
+
+#endif // ASYNC_TASK_H
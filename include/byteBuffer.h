@@ -0,0 +1,51 @@
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+// Contiguous read buffer: bytes are consumed by advancing a read index, and the unread tail is
+// only moved to the front when the buffer runs out of room at the back
+class ByteBuffer
+{
+  public:
+    explicit ByteBuffer(size_t initialSize = 4096);
+
+    size_t readableBytes() const
+    {
+        return m_writeIndex - m_readIndex;
+    }
+    size_t writableBytes() const
+    {
+        return m_buffer.size() - m_writeIndex;
+    }
+    const char *peek() const
+    {
+        return m_buffer.data() + m_readIndex;
+    }
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    void append(const char *data, size_t len);
+
+    // Free the storage of an empty buffer, it grows again on the next append or read
+    void   release();
+    size_t capacity() const
+    {
+        return m_buffer.capacity();
+    }
+
+    // Read from fd straight into the buffer, returns like read(2)
+    ssize_t readFd(int fd);
+
+  private:
+    void ensureWritable(size_t len);
+
+  private:
+    std::vector<char> m_buffer;
+    size_t            m_readIndex  = 0;
+    size_t            m_writeIndex = 0;
+};
+
+#endif // BYTE_BUFFER_H
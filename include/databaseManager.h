@@ -3,6 +3,7 @@
 
 #include <filesystem>
 #include <iomanip>
+#include <memory>
 #include <mutex>
 #include <openssl/sha.h>
 #include <random>
@@ -11,6 +12,9 @@
 #include <stdexcept>
 #include <string>
 
+#include "asyncTask.h"
+#include "executor.h"
+
 class DatabaseManager
 {
   public:
@@ -34,6 +38,20 @@ class DatabaseManager
     ResultCode authenticateUser(const std::string &username, const std::string &password);
     ResultCode deleteUser(const std::string &username);
 
+    // Awaitable versions for async handlers, the query runs on the database executor
+    auto createUserAsync(std::string username, std::string password)
+    {
+        return runOn(*m_executor, [this, username = std::move(username), password = std::move(password)]() {
+            return createUser(username, password);
+        });
+    }
+    auto authenticateUserAsync(std::string username, std::string password)
+    {
+        return runOn(*m_executor, [this, username = std::move(username), password = std::move(password)]() {
+            return authenticateUser(username, password);
+        });
+    }
+
   private:
     std::mutex            m_user_databaseMutex;
     std::mutex            m_msg_databaseMutex;
@@ -41,6 +59,9 @@ class DatabaseManager
     sqlite3              *m_msg_database      = nullptr;
     std::filesystem::path m_user_databasePath = "../data/user.db";
     std::filesystem::path m_msg_databasePath = "../data/msg.db";
+
+    // Threads that block on SQLite for async handlers, password hashing runs there in parallel
+    std::unique_ptr<Executor> m_executor = std::make_unique<Executor>(4);
 };
 
 #endif // DATABASE_MANAGER_H
\ No newline at end of file
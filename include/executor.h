@@ -0,0 +1,62 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A few threads running posted jobs in order, plus jobs that become due at a point in time.
+// Keeps blocking calls (SQLite, Redis) and timers of async handlers off the worker pool.
+class Executor
+{
+  public:
+    using Job = std::function<void()>;
+
+  public:
+    explicit Executor(size_t threadCount = 1);
+    ~Executor();
+
+    Executor(const Executor &)            = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    void post(Job job);
+    void postAt(std::chrono::steady_clock::time_point when, Job job);
+
+    // Shared executor for sleepFor() in async handlers
+    static Executor *timer();
+
+  private:
+    struct TimedJob
+    {
+        std::chrono::steady_clock::time_point when;
+        uint64_t                              sequence; // Keeps jobs due at the same time in post order
+        Job                                   job;
+
+        bool operator>(const TimedJob &other) const
+        {
+            return when != other.when ? when > other.when : sequence > other.sequence;
+        }
+    };
+
+    using TimedQueue = std::priority_queue<TimedJob, std::vector<TimedJob>, std::greater<TimedJob>>;
+
+    void run();
+
+  private:
+    std::mutex               m_mutex;
+    std::condition_variable  m_condition;
+    std::deque<Job>          m_jobs;
+    TimedQueue               m_timedJobs;
+    uint64_t                 m_nextSequence = 0;
+    bool                     m_stop         = false;
+    std::vector<std::thread> m_threads;
+};
+
+#endif // EXECUTOR_H
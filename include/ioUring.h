@@ -0,0 +1,97 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <vector>
+
+// Minimal io_uring wrapper over the raw syscalls: one submission/completion ring pair plus one
+// provided buffer ring. Not thread-safe, every call must come from the thread that created it.
+class IoUring
+{
+  public:
+    // Throws std::runtime_error if the kernel lacks io_uring or the features used here
+    IoUring(unsigned entries, uint16_t bufferGroup, unsigned bufferCount, unsigned bufferSize);
+    ~IoUring();
+
+    IoUring(const IoUring &)            = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    static bool isSupported();
+
+    // Next free submission entry, zeroed; flushes to the kernel first if the ring is full. Null if
+    // that flush fails, e.g. with EBUSY while completions wait to be reaped.
+    io_uring_sqe *getSqe();
+
+    // Submit everything queued and wait for at least one completion or the timeout
+    int submitAndWait(int timeoutMs);
+
+    // Visit all available completions and mark them consumed
+    template <typename F> void forEachCqe(F &&callback)
+    {
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            callback(m_cqes[head & m_cqMask]);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // Provided buffers, selected by the kernel for IOSQE_BUFFER_SELECT requests of bufferGroup()
+    uint16_t bufferGroup() const
+    {
+        return m_bufferGroup;
+    }
+    const char *buffer(uint16_t bufferId) const
+    {
+        return m_buffers.data() + static_cast<size_t>(bufferId) * m_bufferSize;
+    }
+    void recycleBuffer(uint16_t bufferId);
+
+    // False if no submission entry was free, the request was not queued
+    bool prepAccept(int fd, uint64_t userData);
+    bool prepRecv(int fd, uint64_t userData);
+    // msg and what it points to must stay valid until the completion
+    bool prepSendmsg(int fd, const msghdr *msg, uint64_t userData);
+    bool prepPoll(int fd, uint32_t events, bool multishot, uint64_t userData);
+    bool prepCancel(uint64_t targetUserData);
+
+  private:
+    int  submit(unsigned waitNr, int timeoutMs);
+    void setupBufferRing(unsigned bufferCount);
+
+  private:
+    int      m_ringFd   = -1;
+    unsigned m_features = 0;
+
+    void  *m_rings     = nullptr; // Submission and completion rings share one mapping
+    size_t m_ringsSize = 0;
+
+    unsigned *m_sqHead     = nullptr;
+    unsigned *m_sqTail     = nullptr;
+    unsigned  m_sqMask     = 0;
+    unsigned  m_sqEntries  = 0;
+    unsigned  m_sqeTail    = 0; // Local tail, published on submit
+
+    io_uring_sqe *m_sqes     = nullptr;
+    size_t        m_sqesSize = 0;
+
+    unsigned     *m_cqHead = nullptr;
+    unsigned     *m_cqTail = nullptr;
+    unsigned      m_cqMask = 0;
+    io_uring_cqe *m_cqes   = nullptr;
+
+    io_uring_buf_ring *m_bufferRing     = nullptr;
+    size_t             m_bufferRingSize = 0;
+    unsigned           m_bufferMask     = 0;
+    unsigned           m_bufferCount    = 0;
+    uint16_t           m_bufferTail     = 0;
+    uint16_t           m_bufferGroup    = 0;
+    unsigned           m_bufferSize     = 0;
+    std::vector<char>  m_buffers;
+};
+
+#endif // IO_URING_H
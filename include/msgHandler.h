@@ -5,10 +5,21 @@
 #include <string>
 #include <tuple>
 
+#include "asyncTask.h"
+#include "msg.pb.h"
+#include "msg_header.pb.h"
 #include "networkMsg.h"
 
-std::tuple<ClientID, MsgType, std::string> HandleLoginRequest(const ClientID &client, const std::string &message);
+// Reply sent when a request frame cannot be parsed
+void SendInvalidMessageError(const ClientID &client);
 
-std::tuple<ClientID, MsgType, std::string> HandleSignUpRequest(const ClientID &client, const std::string &message);
+// Reply sent instead of handling a request shed under overload
+void SendServerBusyError(const ClientID &client, MsgType msgType);
 
-#endif // MSGHANDLER_H
\ No newline at end of file
+// Both fill the reply in place, the request and reply live on the arena of the call until the coroutine ends
+AsyncTask<void> HandleLoginRequest(ClientID client, const msg::LoginRequest &loginReq, msg::LoginResponse &loginResp);
+
+AsyncTask<void> HandleSignUpRequest(ClientID client, const msg::SignUpRequest &signUpReq,
+                                    msg::SignUpResponse &signUpResp);
+
+#endif // MSGHANDLER_H
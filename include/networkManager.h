@@ -1,59 +1,151 @@
 #ifndef NETWORKMANAGER_H
 #define NETWORKMANAGER_H
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <array>
+#include <atomic>
 #include <cerrno>
 #include <chrono>
-#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <fcntl.h>
+#include <fstream>
+#include <google/protobuf/arena.h>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <malloc.h>
+#include <memory>
 #include <mutex>
+#include <poll.h>
 #include <queue>
-#include <random>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <thread>
 #include <tuple>
 #include <unistd.h>
-#include <unordered_map>
+#include <vector>
 
+#include "admissionControl.h"
+#include "asyncTask.h"
+#include "byteBuffer.h"
+#include "ioUring.h"
+#include "logManager.h"
 #include "networkMsg.h"
+#include "outputQueue.h"
+#include "rateLimiter.h"
+#include "slabPool.h"
+#include "timingWheel.h"
+#include "workerPool.h"
 
-// Provide hash function for unordered_map
-namespace std
-{
-template <> struct hash<ClientID>
-{
-    size_t operator()(const ClientID &c) const
-    {
-        size_t h1 = std::hash<uint64_t>()(c.randomValue);
-        size_t h2 = std::hash<int64_t>()(c.acceptTime.time_since_epoch().count());
+using MsgHandler =
+    std::function<std::tuple<ClientID, MsgType, std::string>(const ClientID &client, const std::string &msg)>;
 
-        // combine hashes
-        return h1 ^ (h2 << 1);
-    }
+// Handler on the raw frame body, responsible for parsing it and sending any reply
+using RawMsgHandler = std::function<void(const ClientID &client, const char *body, size_t size)>;
+
+// Per message type settings, fixed once the server has started
+struct MsgTypeOptions
+{
+    uint32_t maxFrameSize = 64 * 1024;        // Larger frames close the connection
+    uint8_t  priority     = PRIORITY_BY_TYPE; // Higher values are more urgent, see MsgPriority
+    bool     runInline    = false;            // Handler is cheap and may run on the reactor thread
+    bool     rateLimited  = false;            // Counts against the peer address's login rate limit
 };
-} // namespace std
 
 class NetworkManager
 {
-    friend void SendMessage(const ClientID &clientID, MsgType msgType, const std::string &msg);
+    friend void SendMessage(const ClientID &clientID, MsgType msgType, SharedPayload msg);
+    friend void SendMessage(const std::vector<ClientID> &clientIDs, MsgType msgType, SharedPayload msg);
 
   private:
-    struct EpollData
+    struct Reactor;
+
+    struct MsgHandlerEntry
+    {
+        RawMsgHandler  handler;
+        MsgTypeOptions options;
+    };
+
+    // io_uring: one SENDMSG in flight, with the iovecs and header copies the kernel reads until it completes
+    struct UringSend
     {
+        msghdr msg{};
+        iovec  vec[OutputQueue::kMaxIovecs];
+        char   headers[OutputQueue::kMaxFramesPerWrite][OutputQueue::kHeaderSize];
+    };
+
+    struct EpollData : TimerNode
+    {
+        Reactor                              *reactor;
         int                                   fd;
+        uint32_t                              slot = 0; // Index in the reactor's connection pool
+        ClientID                              clientID;  // Zero while the object is not a live connection
         uint16_t                              port;
-        std::string                           ip;
-        std::string                           readBuffer;
-        std::string                           writeBuffer;
+        uint32_t                              address; // IPv4 in network byte order, formatted only for logs
+        ByteBuffer                            readBuffer{0}; // Allocated by the first read, kept while pooled
+        OutputQueue                           writeQueue;
         std::chrono::steady_clock::time_point lastActiveTime;
-        std::function<void(epoll_event &)>    callback;
+        uint32_t                              interest    = 0;     // epoll: events registered for fd
+        bool                                  inReadyList = false;
+        bool                                  readPaused  = false; // write queue above the high watermark
+        bool                                  recvArmed   = false; // io_uring: multishot recv in flight
+        bool                                  inSendList  = false; // io_uring: frames wait for the next submit
+        bool                                  closing     = false; // io_uring: closed, waiting for requests to end
+        uint8_t                               pendingOps  = 0;     // io_uring: requests in flight for this connection
+        std::unique_ptr<UringSend>            send;                // io_uring: set while a SENDMSG is in flight
+    };
+
+    // One event loop: owns a listening socket (SO_REUSEPORT), an epoll instance and its connections
+    struct Reactor
+    {
+        uint32_t                              index    = 0;
+        int                                   serverFd = -1;
+        int                                   epollFd  = -1;
+        int                                   wakeupFd = -1;
+        std::unique_ptr<IoUring>              ring;
+        std::thread                           thread;
+        std::chrono::steady_clock::time_point lastClientCountReportTime{};
+        size_t                                clientCounter = 0;
+
+        // Heartbeat and idle-timeout deadlines of every connection
+        TimingWheel timingWheel;
+
+        // Connection state, recycled together with its buffers
+        SlabPool<EpollData> connectionPool;
+
+        // Live connections, and the generation given to the last one accepted
+        size_t   connectionCount = 0;
+        uint32_t lastGeneration  = 0;
+
+        // Connections that received bytes since the last parse pass
+        std::vector<EpollData *> readyList;
+
+        // io_uring: connections whose queued frames go out with the next submit, and idle send buffers
+        std::vector<EpollData *>                sendList;
+        std::vector<std::unique_ptr<UringSend>> freeSends;
+
+        // Replies written straight from sendMessage() vs. attempts made on an empty write queue
+        std::atomic<uint64_t> directWriteAttempts{0};
+        std::atomic<uint64_t> directWriteCompletions{0};
+
+        std::mutex                                               sendMessageQueueMutex;
+        std::queue<std::tuple<ClientID, MsgType, SharedPayload>> sendMessageQueue;
+        // Reactor thread only: swapped with sendMessageQueue, then sent from without holding the lock
+        std::queue<std::tuple<ClientID, MsgType, SharedPayload>> sendingQueue;
+    };
+
+  public:
+    enum class IoBackend
+    {
+        EPOLL,
+        IO_URING,
     };
 
   private:
@@ -66,53 +158,312 @@ class NetworkManager
     static NetworkManager *instance();
 
     void setPort(uint32_t port);
-    void addMessageHandler(
-        MsgType                                                                                         msgType,
-        std::function<std::tuple<ClientID, MsgType, std::string>(ClientID client, const std::string &)> handler);
+    // Handlers can only be changed before start()
+    void addMessageHandler(MsgType msgType, MsgHandler handler, const MsgTypeOptions &options = MsgTypeOptions());
+    void addRawMessageHandler(MsgType msgType, RawMsgHandler handler, const MsgTypeOptions &options = MsgTypeOptions());
     void removeMessageHandler(MsgType msgType);
+
+    // Typed protobuf handler: the framework parses Req from the frame into a per-thread object and
+    // serializes the filled Resp straight into the outbound payload as respType
+    template <typename Req, typename Resp>
+    void registerHandler(MsgType msgType, MsgType respType,
+                         std::function<void(const ClientID &client, const Req &req, Resp &resp)> handler,
+                         const MsgTypeOptions &options = MsgTypeOptions());
+
+    // Coroutine handler: fills resp from req and may co_await database or timer operations without holding
+    // a worker. It continues on the worker pool after each await, the reply is sent once it returns.
+    template <typename Req, typename Resp>
+    void registerAsyncHandler(MsgType msgType, MsgType respType,
+                              std::function<AsyncTask<void>(ClientID client, const Req &req, Resp &resp)> handler,
+                              const MsgTypeOptions &options = MsgTypeOptions());
+
+    // Called for typed handlers whose frame fails to parse
+    void setInvalidMessageHandler(std::function<void(const ClientID &client)> handler);
+    // Called on a reactor or worker thread for every message shed under overload instead of being handled
+    void setBusyHandler(std::function<void(const ClientID &client, MsgType msgType)> handler);
+
+  private:
+    template <typename Req, typename Resp>
+    void handleTypedMessage(const ClientID &client, const char *body, size_t size, MsgType msgType, MsgType respType,
+                            const std::function<void(const ClientID &, const Req &, Resp &)> &handler, Req &request,
+                            Resp &response);
+    template <typename Req>
+    bool parseTypedMessage(const ClientID &client, const char *body, size_t size, MsgType msgType, Req &request);
+    template <typename Resp>
+    static void sendTypedReply(const ClientID &client, MsgType respType, const Resp &response);
+
+    // Per-thread arena for the messages of one typed request, its first block is reused across resets
+    static constexpr size_t         kRequestArenaBlockSize = 8 * 1024;
+    static google::protobuf::Arena &requestArena();
+
+    // State of one async request, lives as long as its coroutine: the arena of its messages, with the first
+    // block allocated together with it, and the hold on the client's later messages in CLIENT_AFFINE mode
+    struct AsyncRequest
+    {
+        static constexpr size_t kInitialBlockSize = 1024;
+
+        alignas(std::max_align_t) char initialBlock[kInitialBlockSize];
+        google::protobuf::Arena        arena;
+        WorkerPool                    &workerPool;
+        ClientID                       client;
+
+        AsyncRequest(WorkerPool &workerPool, const ClientID &client);
+        ~AsyncRequest();
+    };
+
+  public:
+    void setReactorCount(size_t count);
+    void setMaxAcceptsPerLoop(size_t maxAccepts);
+    void setIoBackend(IoBackend backend);
+    // Stop reading from a connection once its unsent bytes exceed high, resume when they drop to low. Frames
+    // that would take them past limit are dropped: pausing does not stop other clients sending to it. With
+    // io_uring a reactor iteration queues all its frames before their send, so a burst larger than limit is
+    // cut at limit, where epoll has already written the first frames into the socket buffer.
+    void setWriteWatermarks(size_t high, size_t low, size_t limit);
+    // Called on the reactor thread when reading from a client is paused or resumed
+    void setBackpressureHandler(std::function<void(const ClientID &client, bool paused)> handler);
+    // Called on the reactor thread for each frame dropped because the client's write queue is at its limit
+    void setDropHandler(std::function<void(const ClientID &client, MsgType msgType)> handler);
+    // Shed low-priority messages once their queueing delay stays above target for an interval,
+    // or all but critical ones while maxQueueDepth messages wait
+    void setOverloadControl(std::chrono::microseconds target, std::chrono::milliseconds interval,
+                            size_t maxQueueDepth);
+    // Token buckets per peer address: accepted connections, and messages of rateLimited types
+    void setConnectionRateLimit(double perSecond, double burst);
+    void setLoginRateLimit(double perSecond, double burst);
     void start(uint32_t port);
 
   private:
+    void initReactor(Reactor &reactor);
+    // io_uring requests carry their connection pointer with the operation in the low bits
+    enum class UringOp : uint64_t
+    {
+        ACCEPT     = 1,
+        WAKEUP     = 2,
+        RECV       = 3,
+        SEND_READY = 4,
+        SEND       = 5,
+    };
+    static constexpr uint64_t kUringOpMask = 0x7;
+
+    static uint64_t uringUserData(EpollData *data, UringOp op)
+    {
+        return reinterpret_cast<uint64_t>(data) | static_cast<uint64_t>(op);
+    }
+
+    // Logs and throws std::runtime_error once start() has been called, what names the setting
+    void throwIfStarted(const char *what) const;
+    void runReactor(Reactor &reactor);
+    void runEpollReactor(Reactor &reactor);
+    void runUringReactor(Reactor &reactor);
+    void processReactorQueues(Reactor &reactor);
+    void armReactorOp(Reactor &reactor, UringOp op);
+    void handleUringCompletion(Reactor &reactor, const io_uring_cqe &cqe);
+    void queueUringSend(EpollData *data);
+    void submitUringSends(Reactor &reactor);
+    void acceptConnections(Reactor &reactor);
+    void addConnection(Reactor &reactor, int clientFd, const sockaddr_in &clientAddr);
+    bool registerConnection(EpollData *data);
+    // armWrite, flushWriteQueue and resumeReading return false once they had to close the connection
+    bool armWrite(EpollData *data);
+    void updateInterest(EpollData *data);
+    bool flushWriteQueue(EpollData *data);
+    void pauseReading(EpollData *data);
+    bool resumeReading(EpollData *data);
+    void wakeupReactor(Reactor &reactor);
     void closeConnection(EpollData *data);
+    // Pooled read buffers above this size are freed, and the pool is trimmed once idle objects exceed
+    // the live connections by more than the slack
+    static constexpr size_t kMaxPooledBufferSize = 16 * 1024;
+    static constexpr size_t kConnectionPoolSlack = 1024;
+    void                    releaseConnection(EpollData *data);
+    EpollData              *findConnection(Reactor &reactor, const ClientID &clientID);
+    static std::string      peerName(const EpollData *data);
+    void                    trimConnectionPool(Reactor &reactor, std::chrono::steady_clock::time_point now);
+    void onConnectionTimer(EpollData *data);
     void epollCallback(epoll_event &event);
-    bool readMessage(EpollData *data, MsgType &msgType, std::string &msg);
-    void sendMessage(const ClientID &clientID, MsgType msgType, const std::string &msg);
+    // Frame on the wire: big-endian u16 type and u32 body length, then the body
+    static constexpr size_t kFrameHeaderSize = sizeof(uint16_t) + sizeof(uint32_t);
+    // Heartbeat bodies, built once and shared by every heartbeat frame
+    static inline const SharedPayload kPingPayload = std::make_shared<const std::string>("ping");
+    static inline const SharedPayload kPongPayload = std::make_shared<const std::string>("pong");
+
+    bool readMessage(EpollData *data, MsgType &msgType, const char *&body, uint32_t &size);
+    const MsgHandlerEntry *findMsgHandler(MsgType msgType) const;
+    void sendMessage(Reactor &reactor, const ClientID &clientID, MsgType msgType, SharedPayload msg);
+
+  public:
+    uint64_t directWriteAttempts() const;
+    uint64_t directWriteCompletions() const;
+    uint64_t shedMessages() const;
+    WorkerPool::PriorityStats priorityStats(uint8_t priority) const;
 
   public:
     void setMaxWorkerThreads(size_t maxThreads);
+    void setDispatchMode(WorkerPool::DispatchMode mode);
+    void setPriorityWeights(const std::array<unsigned, kPriorityCount> &weights);
 
   private:
     void initThreadPool();
+    void dispatchMessage(WorkerPool::Task &task);
+    void reportPriorityStats();
 
   private:
-    uint32_t                              m_port           = 0;
-    int                                   m_serverFd       = 0;
-    int                                   m_epollFd        = 0;
-    int                                   m_maxEpollEvents = 1024;
-    std::chrono::steady_clock::time_point lastCheckHeartbeatTime{};
-    std::chrono::seconds                  checkHeartbeatInterval{5};
-    std::chrono::seconds                  activeTimeout{15};
-    std::chrono::seconds                  connectionTimeout{45};
-
-    std::unordered_map<ClientID, EpollData *> m_ClientIDToEpollData;
-    std::unordered_map<EpollData *, ClientID> m_EpollDataToClientID;
-    std::unordered_map<
-        MsgType, std::function<std::tuple<ClientID, MsgType, std::string>(const ClientID &client, const std::string &)>>
-        m_msgHandlers;
+    uint32_t             m_port               = 0;
+    int                  m_maxEpollEvents     = 1024;
+    size_t               m_reactorCount       = 1;
+    size_t               m_maxAcceptsPerLoop  = 64;
+    IoBackend            m_ioBackend          = IoBackend::EPOLL;
+    unsigned             m_uringEntries       = 1024;
+    unsigned             m_uringBufferCount   = 1024;
+    unsigned             m_uringBufferSize    = 4096;
+    size_t               m_writeHighWatermark = 1024 * 1024;
+    size_t               m_writeLowWatermark  = 256 * 1024;
+    size_t               m_writeQueueLimit    = 8 * 1024 * 1024;
+    std::chrono::seconds heartbeatInterval{5};
+    std::chrono::seconds clientCountReportInterval{5};
+    std::chrono::seconds activeTimeout{15};
+    std::chrono::seconds connectionTimeout{45};
+    std::chrono::seconds memoryCheckInterval{5};
 
-  private:
-    std::mutex                                             m_readMessageQueueMutex;
-    std::mutex                                             m_sendMessageQueueMutex;
-    std::queue<std::tuple<ClientID, MsgType, std::string>> m_readMessageQueue;
-    std::queue<std::tuple<ClientID, MsgType, std::string>> m_sendMessageQueue;
+    // Low memory is a process-wide condition, one reactor per memoryCheckInterval checks for it and trims
+    std::atomic<std::chrono::steady_clock::rep> m_lastMemoryCheck{0};
+
+    std::vector<std::unique_ptr<Reactor>> m_reactors;
+
+    // Dispatch table indexed by MsgType, read without locking once started
+    std::array<MsgHandlerEntry, kMsgTypeCount>  m_msgHandlers;
+    std::function<void(const ClientID &client)> m_invalidMessageHandler;
+    bool                                        m_started = false;
+
+    std::function<void(const ClientID &client, bool paused)>     m_backpressureHandler;
+    std::function<void(const ClientID &client, MsgType msgType)> m_busyHandler;
+    std::function<void(const ClientID &client, MsgType msgType)> m_dropHandler;
+
+    // Decides which messages reach the worker queue while it is overloaded
+    AdmissionControl m_admissionControl{std::chrono::milliseconds(5), std::chrono::milliseconds(100),
+                                        PRIORITY_CRITICAL};
+
+    // Shared by all reactors, sharded by peer address
+    RateLimiter m_connectionRateLimiter{20, 40};
+    RateLimiter m_loginRateLimiter{5, 10};
 
   private:
-    std::vector<std::thread> m_workers;
-    std::condition_variable  m_condition;
-    size_t                   m_maxWorkerThreads = 0;
-    bool                     m_threadPoolStop   = false;
+    WorkerPool m_workerPool;
+    size_t     m_maxWorkerThreads = 0;
+    // Counters at the previous report, only touched by reactor 0
+    std::array<WorkerPool::PriorityStats, kPriorityCount> m_reportedPriorityStats{};
 };
 
-void SendMessage(const ClientID &clientID, MsgType msgType, const std::string &msg);
+void SendMessage(const ClientID &clientID, MsgType msgType, std::string msg);
+void SendMessage(const ClientID &clientID, MsgType msgType, SharedPayload msg);
+
+// Fan-out: every recipient queues a reference to the same payload
+void SendMessage(const std::vector<ClientID> &clientIDs, MsgType msgType, SharedPayload msg);
+
+template <typename Req, typename Resp>
+void NetworkManager::registerHandler(MsgType msgType, MsgType respType,
+                                     std::function<void(const ClientID &client, const Req &req, Resp &resp)> handler,
+                                     const MsgTypeOptions &options)
+{
+    addRawMessageHandler(
+        msgType,
+        [this, msgType, respType, handler](const ClientID &client, const char *body, size_t size) {
+            if constexpr (google::protobuf::Arena::is_arena_constructable<Req>::value &&
+                          google::protobuf::Arena::is_arena_constructable<Resp>::value)
+            {
+                // Both messages and everything they own live on this thread's arena, freed by one reset
+                google::protobuf::Arena &arena = requestArena();
+                handleTypedMessage(client, body, size, msgType, respType, handler,
+                                   *google::protobuf::Arena::CreateMessage<Req>(&arena),
+                                   *google::protobuf::Arena::CreateMessage<Resp>(&arena));
+                arena.Reset();
+            }
+            else
+            {
+                // Generated without cc_enable_arenas: reuse per-thread messages, Clear() keeps their capacity
+                thread_local Req  request;
+                thread_local Resp response;
+                request.Clear();
+                response.Clear();
+                handleTypedMessage(client, body, size, msgType, respType, handler, request, response);
+            }
+        },
+        options);
+}
+
+template <typename Req, typename Resp>
+void NetworkManager::registerAsyncHandler(MsgType msgType, MsgType respType,
+                                          std::function<AsyncTask<void>(ClientID client, const Req &req, Resp &resp)>
+                                              handler,
+                                          const MsgTypeOptions &options)
+{
+    // Continuations are posted at the priority the message itself gets
+    uint8_t priority = options.priority == PRIORITY_BY_TYPE ? static_cast<uint8_t>(DefaultMsgPriority(msgType))
+                                                            : options.priority;
+    addRawMessageHandler(
+        msgType,
+        [this, msgType, respType, handler, priority](const ClientID &client, const char *body, size_t size) {
+            // The coroutine outlives this call, so its messages get an arena of their own instead of the
+            // per-thread one. The return callback holds it and is destroyed with the coroutine frame, only
+            // then may an affine worker start on the client's next message.
+            auto  call     = std::make_shared<AsyncRequest>(m_workerPool, client);
+            Req  &request  = *google::protobuf::Arena::Create<Req>(&call->arena);
+            Resp &response = *google::protobuf::Arena::Create<Resp>(&call->arena);
+            if (!parseTypedMessage(client, body, size, msgType, request))
+            {
+                return;
+            }
+
+            AsyncTask<void> task = handler(client, request, response);
+            task.start(
+                [this, client, priority](std::coroutine_handle<> handle) {
+                    m_workerPool.post(client, priority, [handle]() { handle.resume(); });
+                },
+                [client, respType, call, &response]() { sendTypedReply(client, respType, response); });
+        },
+        options);
+}
+
+template <typename Req, typename Resp>
+void NetworkManager::handleTypedMessage(const ClientID &client, const char *body, size_t size, MsgType msgType,
+                                        MsgType respType,
+                                        const std::function<void(const ClientID &, const Req &, Resp &)> &handler,
+                                        Req &request, Resp &response)
+{
+    if (!parseTypedMessage(client, body, size, msgType, request))
+    {
+        return;
+    }
+    handler(client, request, response);
+    sendTypedReply(client, respType, response);
+}
+
+template <typename Req>
+bool NetworkManager::parseTypedMessage(const ClientID &client, const char *body, size_t size, MsgType msgType,
+                                       Req &request)
+{
+    if (!request.ParseFromArray(body, static_cast<int>(size)))
+    {
+        LOG_ERROR(networkLogger,
+                  "Failed to parse message of type " + std::to_string(static_cast<unsigned int>(msgType)));
+        if (m_invalidMessageHandler)
+        {
+            m_invalidMessageHandler(client);
+        }
+        return false;
+    }
+    return true;
+}
+
+template <typename Resp>
+void NetworkManager::sendTypedReply(const ClientID &client, MsgType respType, const Resp &response)
+{
+    // Serialize into the payload that is queued on the connection, no intermediate string
+    size_t payloadSize = response.ByteSizeLong();
+    auto   payload     = std::make_shared<std::string>(payloadSize, '\0');
+    response.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t *>(&(*payload)[0]));
+    SendMessage(client, respType, SharedPayload(std::move(payload)));
+}
 
 #endif // NETWORKMANAGER_H
\ No newline at end of file
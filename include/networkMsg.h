@@ -2,6 +2,11 @@
 #define NETWORKMSG_H
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 
 enum class MsgType : unsigned int
 {
@@ -24,17 +29,107 @@ enum class MsgType : unsigned int
     USER_ONLINE,
     USER_OFFLINE,
     USER_TYPEING,
+
+    SERVER_BUSY_ERROR,
+
+    MSG_TYPE_COUNT, // Number of message types, keep last
+};
+
+constexpr size_t kMsgTypeCount = static_cast<size_t>(MsgType::MSG_TYPE_COUNT);
+
+// Handler priorities: workers serve higher ones more often, and shed from the lowest up while overloaded
+enum MsgPriority : uint8_t
+{
+    PRIORITY_TYPING    = 0,
+    PRIORITY_HEARTBEAT = 1,
+    PRIORITY_SIGN_UP   = 2,
+    PRIORITY_LOGIN     = 3,
+    PRIORITY_CHAT      = 4, // Chat text and acks
+    PRIORITY_COUNT,         // Number of priorities, keep after the real ones
+    PRIORITY_CRITICAL = PRIORITY_LOGIN, // Lowest priority that is never shed
+    PRIORITY_BY_TYPE  = 0xFF,           // Handler options only: take DefaultMsgPriority() of the message type
 };
 
+constexpr size_t kPriorityCount = static_cast<size_t>(PRIORITY_COUNT);
+
+// Priority of a message type whose handler options do not set one. Types not listed are shed first.
+constexpr MsgPriority DefaultMsgPriority(MsgType msgType)
+{
+    switch (msgType)
+    {
+    case MsgType::CHAT_TEXT:
+    case MsgType::CHAT_ACK:
+    case MsgType::USER_ONLINE:
+    case MsgType::USER_OFFLINE:
+        return PRIORITY_CHAT;
+    case MsgType::LOGIN_REQUEST:
+    case MsgType::LOGIN_RESPONSE:
+    case MsgType::LOGOUT_REQUEST:
+    case MsgType::LOGOUT_RESPONSE:
+        return PRIORITY_LOGIN;
+    case MsgType::SIGN_UP_REQUEST:
+    case MsgType::SIGN_UP_RESPONSE:
+        return PRIORITY_SIGN_UP;
+    case MsgType::HEARTBEAT:
+        return PRIORITY_HEARTBEAT;
+    case MsgType::USER_TYPEING:
+    default:
+        return PRIORITY_TYPING;
+    }
+}
+
+// Connection handle packed into 64 bits: the owning reactor, a generation that is new for every connection,
+// and the connection's slot in the reactor's table. A handle that outlives its connection never matches the
+// next connection in the same slot. Zero is never handed out.
 struct ClientID
 {
-    std::chrono::steady_clock::time_point acceptTime;
-    uint64_t                              randomValue;
+    static constexpr unsigned kSlotBits       = 24;
+    static constexpr unsigned kGenerationBits = 32;
+    static constexpr uint32_t kMaxReactors    = 1u << (64 - kGenerationBits - kSlotBits);
+    static constexpr uint32_t kMaxSlots       = 1u << kSlotBits;
+
+    uint64_t value = 0;
+
+    ClientID() = default;
+    ClientID(uint32_t reactorIndex, uint32_t generation, uint32_t slot)
+        : value(static_cast<uint64_t>(reactorIndex) << (kGenerationBits + kSlotBits) |
+                static_cast<uint64_t>(generation) << kSlotBits | slot)
+    {
+    }
+
+    uint32_t reactorIndex() const
+    {
+        return static_cast<uint32_t>(value >> (kGenerationBits + kSlotBits));
+    }
+    uint32_t generation() const
+    {
+        return static_cast<uint32_t>(value >> kSlotBits);
+    }
+    uint32_t slot() const
+    {
+        return static_cast<uint32_t>(value & (kMaxSlots - 1));
+    }
 
     bool operator==(const ClientID &other) const
     {
-        return acceptTime == other.acceptTime && randomValue == other.randomValue;
+        return value == other.value;
     }
 };
 
+// Provide hash function for unordered_map
+namespace std
+{
+template <> struct hash<ClientID>
+{
+    size_t operator()(const ClientID &c) const
+    {
+        // Slots are dense and differ in the low bits already
+        return std::hash<uint64_t>()(c.value);
+    }
+};
+} // namespace std
+
+// Immutable serialized message body, shared by every connection it is queued on
+using SharedPayload = std::shared_ptr<const std::string>;
+
 #endif  // NETWORKMSG_H
@@ -0,0 +1,60 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include "networkMsg.h"
+
+// Outbound frames of one connection, each kept as a header and a reference to a shared body, flushed with writev
+class OutputQueue
+{
+  public:
+    static constexpr size_t kHeaderSize        = sizeof(uint16_t) + sizeof(uint32_t);
+    static constexpr size_t kMaxFramesPerWrite = 64;
+    static constexpr size_t kMaxIovecs         = kMaxFramesPerWrite * 2;
+
+    void push(MsgType msgType, SharedPayload body);
+    // Drop every unsent frame, release() also frees the storage, which is allocated again by the next push
+    void clear();
+    void release();
+
+    bool empty() const
+    {
+        return m_head == m_frames.size();
+    }
+    size_t queuedBytes() const
+    {
+        return m_queuedBytes;
+    }
+
+    // Write as many queued frames as possible in one writev, returns like write(2)
+    ssize_t writeFd(int fd);
+
+    // The unsent part of up to kMaxFramesPerWrite frames as iovecs into vec, returns their count. Bodies
+    // stay put while queued, but a push may move the headers: with headerCopy the iovecs point at copies
+    // there instead, so they stay valid until consume() for a write the kernel finishes later.
+    int gather(iovec *vec, char (*headerCopy)[kHeaderSize] = nullptr);
+    // Drop n written bytes from the front
+    void consume(size_t n);
+
+  private:
+    struct Frame
+    {
+        char          header[kHeaderSize];
+        SharedPayload body;
+    };
+
+    // Frames before m_head are sent, the vector is reset once all are. Unlike a deque, an empty
+    // vector holds no memory, which matters for the many connections that have nothing to send.
+    std::vector<Frame> m_frames;
+    size_t             m_head        = 0;
+    size_t             m_frontOffset = 0; // Bytes of the front frame (header + body) already written
+    size_t             m_queuedBytes = 0;
+};
+
+#endif // OUTPUT_QUEUE_H
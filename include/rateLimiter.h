@@ -0,0 +1,52 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Token buckets keyed by IPv4 address, one per peer. The table is split into shards with their own
+// lock, so reactors checking different peers rarely contend. Buckets idle for the idle timeout, and
+// long enough to have refilled completely, are dropped by a periodic sweep of their shard.
+class RateLimiter
+{
+  public:
+    RateLimiter(double ratePerSecond, double burst, size_t shardCount = 16,
+                std::chrono::seconds idleTimeout = std::chrono::seconds(60));
+
+    // Only safe before the limiter is used
+    void configure(double ratePerSecond, double burst);
+
+    // Take one token from the address's bucket, false if it is empty
+    bool tryAcquire(uint32_t address, std::chrono::steady_clock::time_point now);
+
+    size_t size() const;
+
+  private:
+    struct Bucket
+    {
+        double                                tokens;
+        std::chrono::steady_clock::time_point lastRefill;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex                    mutex;
+        std::unordered_map<uint32_t, Bucket>  buckets;
+        std::chrono::steady_clock::time_point nextSweep{};
+    };
+
+    void sweep(Shard &shard, std::chrono::steady_clock::time_point now);
+
+  private:
+    double                   m_ratePerSecond;
+    double                   m_burst;
+    size_t                   m_shardMask;
+    std::chrono::seconds     m_idleTimeout;
+    std::unique_ptr<Shard[]> m_shards;
+};
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,129 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Objects carved out of slabs of SlabSize, for use by a single thread. A released object stays
+// constructed on the free list and is handed out again as it is, so the memory it owns (buffers,
+// strings) is reused by the next owner. trim() drops what idle objects own and frees slabs that
+// have no object in use. T needs a uint32_t slot member, which the pool sets to the object's index.
+template <typename T, size_t SlabSize = 256>
+class SlabPool
+{
+  public:
+    T *acquire()
+    {
+        if (m_freeSlots.empty())
+        {
+            addSlab();
+        }
+        uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        --m_slabs[slot / SlabSize].freeCount;
+        return &m_slabs[slot / SlabSize].objects[slot % SlabSize];
+    }
+
+    // Object at slot, in use or not, nullptr if its slab has been freed
+    T *at(uint32_t slot)
+    {
+        size_t index = slot / SlabSize;
+        return index < m_slabs.size() && m_slabs[index].objects ? &m_slabs[index].objects[slot % SlabSize] : nullptr;
+    }
+    size_t slotCount() const
+    {
+        return m_slabs.size() * SlabSize;
+    }
+
+    void release(T *object)
+    {
+        m_freeSlots.push_back(object->slot);
+        ++m_slabs[object->slot / SlabSize].freeCount;
+    }
+
+    // Give memory held by idle objects back: empty slabs are freed, trimObject is called on the other free objects
+    template <typename F> void trim(F &&trimObject)
+    {
+        for (size_t i = 0; i < m_slabs.size(); ++i)
+        {
+            Slab &slab = m_slabs[i];
+            if (slab.objects && slab.freeCount == SlabSize)
+            {
+                slab.objects.reset();
+            }
+        }
+
+        // Keep only the slots of surviving slabs, lowest at the back so acquire() packs objects into few slabs
+        std::vector<uint32_t> freeSlots;
+        for (uint32_t slot : m_freeSlots)
+        {
+            Slab &slab = m_slabs[slot / SlabSize];
+            if (slab.objects)
+            {
+                trimObject(slab.objects[slot % SlabSize]);
+                freeSlots.push_back(slot);
+            }
+            else
+            {
+                slab.freeCount = 0;
+            }
+        }
+        std::sort(freeSlots.begin(), freeSlots.end(), std::greater<uint32_t>());
+        m_freeSlots.swap(freeSlots);
+    }
+
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const Slab &slab : m_slabs)
+        {
+            total += slab.objects ? SlabSize : 0;
+        }
+        return total;
+    }
+    size_t freeCount() const
+    {
+        return m_freeSlots.size();
+    }
+
+  private:
+    struct Slab
+    {
+        std::unique_ptr<T[]> objects;
+        size_t               freeCount = 0;
+    };
+
+    void addSlab()
+    {
+        // Refill a slab freed by trim() before growing the table
+        size_t index = 0;
+        while (index < m_slabs.size() && m_slabs[index].objects)
+        {
+            ++index;
+        }
+        if (index == m_slabs.size())
+        {
+            m_slabs.emplace_back();
+        }
+
+        Slab &slab     = m_slabs[index];
+        slab.objects   = std::make_unique<T[]>(SlabSize);
+        slab.freeCount = SlabSize;
+        for (size_t i = SlabSize; i-- > 0;)
+        {
+            uint32_t slot        = static_cast<uint32_t>(index * SlabSize + i);
+            slab.objects[i].slot = slot;
+            m_freeSlots.push_back(slot);
+        }
+    }
+
+  private:
+    std::vector<Slab>     m_slabs;
+    std::vector<uint32_t> m_freeSlots; // Stack, the next slot handed out is at the back
+};
+
+#endif // SLAB_POOL_H
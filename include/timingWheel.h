@@ -0,0 +1,44 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Intrusive hook for objects scheduled on a TimingWheel
+struct TimerNode
+{
+    TimerNode *timerPrev  = nullptr;
+    TimerNode *timerNext  = nullptr;
+    uint64_t   expireTick = 0;
+    bool       timerArmed = false;
+};
+
+// Hashed timing wheel: scheduling, cancelling and expiring a node are O(1),
+// deadlines further than one revolution away wait in their slot for extra rounds
+class TimingWheel
+{
+  public:
+    TimingWheel(std::chrono::milliseconds tick = std::chrono::seconds(1), size_t slotCount = 64);
+
+    void schedule(TimerNode *node, std::chrono::steady_clock::time_point deadline);
+    void cancel(TimerNode *node);
+
+    // Unlink every node whose deadline has passed and hand it to onExpire, which may re-schedule it
+    void advance(std::chrono::steady_clock::time_point now, const std::function<void(TimerNode *)> &onExpire);
+
+  private:
+    uint64_t toTick(std::chrono::steady_clock::time_point time) const;
+    void     link(TimerNode *node);
+    void     unlink(TimerNode *node);
+
+  private:
+    std::chrono::steady_clock::time_point m_startTime;
+    std::chrono::milliseconds             m_tick;
+    uint64_t                              m_currentTick = 0;
+    std::vector<TimerNode *>              m_slots;
+    std::vector<TimerNode *>              m_expired;
+};
+
+#endif // TIMING_WHEEL_H
@@ -0,0 +1,123 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "networkMsg.h"
+
+// Worker threads with one task deque per priority each. In WORK_STEALING mode submitters spread tasks
+// round-robin and an idle worker steals from the others' deques before it goes to sleep; a submit wakes a
+// sleeping one, so a task queued behind a slow handler is taken by whoever is free. Deques are served
+// by weighted round-robin, so a flood of one priority slows the others by their weight share only. In
+// CLIENT_AFFINE mode every task of a ClientID goes to the same worker and nothing is stolen, so a client's
+// messages are handled one at a time and in arrival order; all priorities share one deque there. A handler
+// that answers after it returns holds the client meanwhile, its later messages wait until it is released.
+class WorkerPool
+{
+  public:
+    enum class DispatchMode
+    {
+        WORK_STEALING,
+        CLIENT_AFFINE,
+    };
+
+    struct Task
+    {
+        ClientID                              clientID;
+        MsgType                               msgType;
+        std::string                           msg;
+        std::function<void()>                 job;          // Set for posted jobs, which run instead of the handler
+        uint8_t                               priority = 0; // See MsgPriority
+        std::chrono::steady_clock::time_point enqueueTime;  // Set by submit()
+    };
+    using Handler = std::function<void(Task &)>;
+
+    struct PriorityStats
+    {
+        size_t                   queued;    // Waiting right now
+        uint64_t                 handled;   // Taken by a worker since start
+        std::chrono::nanoseconds totalWait; // Queueing delay of the handled ones
+    };
+
+  public:
+    WorkerPool() = default;
+    ~WorkerPool();
+
+    // Both throw once the pool has started
+    void setDispatchMode(DispatchMode mode);
+    // Share of worker time per priority while several are queued
+    void setPriorityWeights(const std::array<unsigned, kPriorityCount> &weights);
+    void start(size_t workerCount, Handler handler);
+    void stop();
+    void submit(Task task);
+
+    // Run job on a worker, routed by clientID like that client's messages
+    void post(const ClientID &clientID, uint8_t priority, std::function<void()> job);
+
+    // CLIENT_AFFINE only: set the client's further messages aside until releaseClient(), posted jobs still run.
+    // Called from the client's worker while it handles a message.
+    void holdClient(const ClientID &clientID);
+    void releaseClient(const ClientID &clientID);
+
+    // Tasks submitted but not yet taken by a worker, across all deques
+    size_t queuedTasks() const
+    {
+        return m_queuedTasks.load(std::memory_order_relaxed);
+    }
+    PriorityStats priorityStats(uint8_t priority) const;
+
+  private:
+    struct Worker
+    {
+        std::mutex                                     mutex;
+        std::condition_variable                        condition;
+        std::array<std::deque<Task>, kPriorityCount>   tasks;
+        std::array<int64_t, kPriorityCount>            credits{}; // Weighted round-robin state of the deques
+        size_t                                         taskCount = 0;
+        std::unordered_map<ClientID, std::deque<Task>> held; // Messages of held clients, in arrival order
+        std::thread                                    thread;
+    };
+
+    struct alignas(64) Counters
+    {
+        std::atomic<size_t>   queued{0};
+        std::atomic<uint64_t> handled{0};
+        std::atomic<int64_t>  waitNanos{0};
+    };
+
+    Worker &affineWorker(const ClientID &clientID);
+    void    throwIfStarted(const char *what) const;
+    void    run(size_t index);
+    bool popLocal(size_t index, Task &task);
+    bool steal(size_t index, Task &task);
+    bool takeNext(Worker &worker, Task &task);
+
+  private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    Handler                              m_handler;
+    DispatchMode                         m_mode = DispatchMode::WORK_STEALING;
+    std::atomic<size_t>                  m_nextWorker{0};
+    std::atomic<size_t>                  m_queuedTasks{0};
+    std::array<unsigned, kPriorityCount> m_weights{1, 1, 2, 4, 8}; // Typing up to chat
+    std::array<Counters, kPriorityCount> m_counters;
+    std::atomic<bool>                    m_stop{false};
+
+    // WORK_STEALING workers sleep here rather than on their own condition, any of them can take a task
+    std::mutex              m_idleMutex;
+    std::condition_variable m_idleCondition;
+    std::atomic<size_t>     m_idleWorkers{0};
+};
+
+#endif // WORKER_POOL_H
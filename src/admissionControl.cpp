@@ -0,0 +1,109 @@
+#include "admissionControl.h"
+
+#include "logManager.h"
+
+#include <algorithm>
+
+AdmissionControl::AdmissionControl(std::chrono::microseconds target, std::chrono::milliseconds interval,
+                                   uint8_t maxLevel, size_t maxQueueDepth)
+    : m_target(target), m_interval(interval), m_maxLevel(maxLevel), m_maxQueueDepth(maxQueueDepth)
+{
+}
+
+void AdmissionControl::configure(std::chrono::microseconds target, std::chrono::milliseconds interval,
+                                 size_t maxQueueDepth)
+{
+    m_target        = target;
+    m_interval      = interval;
+    m_maxQueueDepth = maxQueueDepth;
+}
+
+bool AdmissionControl::admit(uint8_t priority, size_t queueDepth)
+{
+    // Nothing waiting: the overload is over, its end is reported once this message is dequeued
+    if (queueDepth == 0)
+    {
+        return true;
+    }
+
+    // A full queue sheds every level at once, otherwise only priorities below the current level
+    uint8_t level = queueDepth >= m_maxQueueDepth ? m_maxLevel : m_shedLevel.load(std::memory_order_relaxed);
+    if (priority >= level)
+    {
+        return true;
+    }
+    m_shedCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void AdmissionControl::onDequeue(uint8_t priority, std::chrono::steady_clock::duration sojourn, size_t queueDepth,
+                                 std::chrono::steady_clock::time_point now)
+{
+    // Nothing left behind: the queue is keeping up
+    if (queueDepth == 0)
+    {
+        for (auto &slowUntil : m_slowUntil)
+        {
+            slowUntil.store(0, std::memory_order_relaxed);
+        }
+        recover();
+        return;
+    }
+
+    // A short wait only clears its own priority. The others stay slow for an interval after their last long
+    // wait, so quickly served high priorities cannot end the overload of a low one with a standing queue.
+    int64_t               nowTicks  = now.time_since_epoch().count();
+    std::atomic<int64_t> &slowUntil = m_slowUntil[std::min<size_t>(priority, kPriorityCount - 1)];
+    if (sojourn >= m_target)
+    {
+        slowUntil.store(nowTicks + m_interval.count(), std::memory_order_relaxed);
+    }
+    else if (slowUntil.load(std::memory_order_relaxed) != 0)
+    {
+        slowUntil.store(0, std::memory_order_relaxed);
+    }
+    bool slow = false;
+    for (const auto &until : m_slowUntil)
+    {
+        slow = slow || until.load(std::memory_order_relaxed) > nowTicks;
+    }
+    if (!slow)
+    {
+        recover();
+        return;
+    }
+
+    // First wait above target starts the interval, a standing queue only shows once it has passed
+    int64_t escalateAt = m_escalateAt.load(std::memory_order_relaxed);
+    if (escalateAt == 0)
+    {
+        m_escalateAt.compare_exchange_strong(escalateAt, nowTicks + m_interval.count(), std::memory_order_relaxed);
+        return;
+    }
+
+    // One worker per interval raises the level, the others see the new deadline
+    if (nowTicks >= escalateAt &&
+        m_escalateAt.compare_exchange_strong(escalateAt, nowTicks + m_interval.count(), std::memory_order_relaxed))
+    {
+        uint8_t level = m_shedLevel.load(std::memory_order_relaxed);
+        if (level < m_maxLevel)
+        {
+            m_shedLevel.store(level + 1, std::memory_order_relaxed);
+            LOG_WARN(networkLogger, "Worker queue overloaded, " + std::to_string(queueDepth) +
+                                        " messages waiting, shedding priorities below " + std::to_string(level + 1));
+        }
+    }
+}
+
+void AdmissionControl::recover()
+{
+    if (m_escalateAt.load(std::memory_order_relaxed) != 0)
+    {
+        m_escalateAt.store(0, std::memory_order_relaxed);
+    }
+    if (m_shedLevel.load(std::memory_order_relaxed) != 0)
+    {
+        m_shedLevel.store(0, std::memory_order_relaxed);
+        LOG_INFO(networkLogger, "Worker queue recovered, admitting all messages");
+    }
+}
@@ -0,0 +1,96 @@
+#include "byteBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/uio.h>
+
+ByteBuffer::ByteBuffer(size_t initialSize) : m_buffer(initialSize) {}
+
+void ByteBuffer::retrieve(size_t len)
+{
+    if (len < readableBytes())
+    {
+        m_readIndex += len;
+    }
+    else
+    {
+        retrieveAll();
+    }
+}
+
+void ByteBuffer::retrieveAll()
+{
+    // Nothing left to read, start over at the front without moving any bytes
+    m_readIndex  = 0;
+    m_writeIndex = 0;
+}
+
+void ByteBuffer::release()
+{
+    retrieveAll();
+    std::vector<char>().swap(m_buffer);
+}
+
+void ByteBuffer::append(const char *data, size_t len)
+{
+    ensureWritable(len);
+    std::memcpy(m_buffer.data() + m_writeIndex, data, len);
+    m_writeIndex += len;
+}
+
+ssize_t ByteBuffer::readFd(int fd)
+{
+    // Fill the free space at the back first, overflow goes to the stack and is appended afterwards
+    char         extraBuffer[65536];
+    struct iovec vec[2];
+    const size_t writable = writableBytes();
+    vec[0].iov_base       = m_buffer.data() + m_writeIndex;
+    vec[0].iov_len        = writable;
+    vec[1].iov_base       = extraBuffer;
+    vec[1].iov_len        = sizeof(extraBuffer);
+
+    // Skip the stack buffer when the free space is already large
+    const int iovcnt = writable < sizeof(extraBuffer) ? 2 : 1;
+    ssize_t   n      = readv(fd, vec, iovcnt);
+    if (n <= 0)
+    {
+        return n;
+    }
+
+    if (static_cast<size_t>(n) <= writable)
+    {
+        m_writeIndex += n;
+    }
+    else
+    {
+        m_writeIndex = m_buffer.size();
+        append(extraBuffer, n - writable);
+    }
+    return n;
+}
+
+void ByteBuffer::ensureWritable(size_t len)
+{
+    if (writableBytes() >= len)
+    {
+        return;
+    }
+
+    // Reuse the consumed space at the front if that is enough, otherwise grow
+    const size_t readable = readableBytes();
+    if (m_readIndex + writableBytes() >= len)
+    {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_readIndex, readable);
+    }
+    else
+    {
+        std::vector<char> buffer(std::max(m_buffer.size() * 2, readable + len));
+        if (readable > 0)
+        {
+            std::memcpy(buffer.data(), m_buffer.data() + m_readIndex, readable);
+        }
+        m_buffer.swap(buffer);
+    }
+    m_readIndex  = 0;
+    m_writeIndex = readable;
+}
@@ -71,6 +71,8 @@ DatabaseManager::DatabaseManager()
 
 DatabaseManager::~DatabaseManager()
 {
+    // Let queries in flight finish before the connections close
+    m_executor.reset();
     if (m_user_database)
     {
         sqlite3_close(m_user_database);
@@ -0,0 +1,89 @@
+#include "executor.h"
+
+#include <algorithm>
+
+Executor::Executor(size_t threadCount)
+{
+    for (size_t i = 0; i < std::max<size_t>(1, threadCount); ++i)
+    {
+        m_threads.emplace_back([this]() { run(); });
+    }
+}
+
+Executor::~Executor()
+{
+    // Queued jobs still run, timed jobs that are not due yet are dropped
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void Executor::post(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_condition.notify_one();
+}
+
+void Executor::postAt(std::chrono::steady_clock::time_point when, Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_timedJobs.push({when, m_nextSequence++, std::move(job)});
+    }
+    // The new job may be due before the one a thread is sleeping for
+    m_condition.notify_all();
+}
+
+Executor *Executor::timer()
+{
+    static Executor *instance = new Executor(1);
+    return instance;
+}
+
+void Executor::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        // Move timed jobs that are due to the back of the queue
+        auto now = std::chrono::steady_clock::now();
+        while (!m_timedJobs.empty() && m_timedJobs.top().when <= now)
+        {
+            m_jobs.push_back(std::move(const_cast<TimedJob &>(m_timedJobs.top()).job));
+            m_timedJobs.pop();
+        }
+
+        if (!m_jobs.empty())
+        {
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+            continue;
+        }
+        if (m_stop)
+        {
+            return;
+        }
+
+        // Sleep until a job is posted or the earliest timed job is due
+        if (m_timedJobs.empty())
+        {
+            m_condition.wait(lock);
+        }
+        else
+        {
+            m_condition.wait_until(lock, m_timedJobs.top().when);
+        }
+    }
+}
@@ -0,0 +1,334 @@
+#include "ioUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <linux/time_types.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace
+{
+int IoUringSetup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+int IoUringRegister(int fd, unsigned opcode, const void *arg, unsigned argCount)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, argCount));
+}
+} // namespace
+
+IoUring::IoUring(unsigned entries, uint16_t bufferGroup, unsigned bufferCount, unsigned bufferSize)
+    : m_bufferGroup(bufferGroup), m_bufferSize(bufferSize)
+{
+    // Completions for multishot requests pile up faster than submissions, give them more room.
+    // Single issuer + deferred task running keep completion work on the reactor thread.
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER |
+                   IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = entries * 4;
+    m_ringFd          = IoUringSetup(entries, &params);
+    if (m_ringFd < 0 && errno == EINVAL)
+    {
+        // Older kernel, retry without the optional flags
+        params            = io_uring_params{};
+        params.flags      = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        m_ringFd          = IoUringSetup(entries, &params);
+    }
+    if (m_ringFd < 0)
+    {
+        throw std::runtime_error("io_uring_setup failed: " + std::string(strerror(errno)));
+    }
+
+    m_features = params.features;
+    if (!(m_features & IORING_FEAT_SINGLE_MMAP) || !(m_features & IORING_FEAT_EXT_ARG) ||
+        !(m_features & IORING_FEAT_NODROP))
+    {
+        close(m_ringFd);
+        throw std::runtime_error("io_uring lacks required features");
+    }
+
+    // Map the submission and completion rings, one mapping serves both
+    size_t sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    m_ringsSize       = std::max(sqRingSize, cqRingSize);
+    m_rings           = mmap(nullptr, m_ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                             IORING_OFF_SQ_RING);
+    if (m_rings == MAP_FAILED)
+    {
+        close(m_ringFd);
+        throw std::runtime_error("Failed to map io_uring rings");
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes     = static_cast<io_uring_sqe *>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES));
+    if (m_sqes == MAP_FAILED)
+    {
+        munmap(m_rings, m_ringsSize);
+        close(m_ringFd);
+        throw std::runtime_error("Failed to map io_uring submission entries");
+    }
+
+    char *sq    = static_cast<char *>(m_rings);
+    m_sqHead    = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    m_sqTail    = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    m_sqMask    = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    m_sqEntries = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+    m_sqeTail   = *m_sqTail;
+
+    // Submission slots map one-to-one onto entries
+    unsigned *array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < m_sqEntries; ++i)
+    {
+        array[i] = i;
+    }
+
+    char *cq = static_cast<char *>(m_rings);
+    m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    m_cqes   = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    try
+    {
+        setupBufferRing(bufferCount);
+    }
+    catch (...)
+    {
+        munmap(m_sqes, m_sqesSize);
+        munmap(m_rings, m_ringsSize);
+        close(m_ringFd);
+        throw;
+    }
+}
+
+IoUring::~IoUring()
+{
+    if (m_bufferRing)
+    {
+        munmap(m_bufferRing, m_bufferRingSize);
+    }
+    munmap(m_sqes, m_sqesSize);
+    munmap(m_rings, m_ringsSize);
+    close(m_ringFd);
+}
+
+bool IoUring::isSupported()
+{
+    // Multishot recv with provided buffer rings needs Linux 6.0
+    utsname name{};
+    if (uname(&name) != 0)
+    {
+        return false;
+    }
+    int major = 0;
+    int minor = 0;
+    if (sscanf(name.release, "%d.%d", &major, &minor) != 2 || major < 6)
+    {
+        return false;
+    }
+
+    // Setup can still be refused, e.g. by a seccomp filter or io_uring_disabled
+    try
+    {
+        IoUring probe(8, 0, 8, 64);
+        return true;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+io_uring_sqe *IoUring::getSqe()
+{
+    // Ring full, hand what is queued to the kernel first
+    while (m_sqeTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+    {
+        int ret = submit(0, 0);
+        if (ret < 0 && ret != -EINTR)
+        {
+            return nullptr;
+        }
+    }
+
+    io_uring_sqe *sqe = &m_sqes[m_sqeTail & m_sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++m_sqeTail;
+    return sqe;
+}
+
+int IoUring::submitAndWait(int timeoutMs)
+{
+    int ret = submit(1, timeoutMs);
+    if (ret == -ETIME || ret == -EINTR || ret == -EBUSY)
+    {
+        // Timed out, interrupted, or completions are waiting to be reaped: not an error
+        return 0;
+    }
+    return ret;
+}
+
+int IoUring::submit(unsigned waitNr, int timeoutMs)
+{
+    // Publish the locally queued entries
+    unsigned toSubmit = m_sqeTail - *m_sqTail;
+    __atomic_store_n(m_sqTail, m_sqeTail, __ATOMIC_RELEASE);
+
+    if (waitNr == 0)
+    {
+        int ret = IoUringEnter(m_ringFd, toSubmit, 0, 0, nullptr, 0);
+        return ret < 0 ? -errno : ret;
+    }
+
+    __kernel_timespec             timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000LL};
+    struct io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts         = reinterpret_cast<uint64_t>(&timeout);
+    int ret = IoUringEnter(m_ringFd, toSubmit, waitNr, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                           sizeof(arg));
+    return ret < 0 ? -errno : ret;
+}
+
+void IoUring::setupBufferRing(unsigned bufferCount)
+{
+    // Ring size must be a power of two
+    unsigned count = 1;
+    while (count < bufferCount)
+    {
+        count <<= 1;
+    }
+    m_bufferCount = count;
+    m_bufferMask  = count - 1;
+    m_buffers.resize(static_cast<size_t>(count) * m_bufferSize);
+
+    // The ring itself must be page aligned, anonymous mappings are
+    m_bufferRingSize = count * sizeof(io_uring_buf);
+    void *ring = mmap(nullptr, m_bufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to allocate io_uring buffer ring");
+    }
+    m_bufferRing = static_cast<io_uring_buf_ring *>(ring);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr    = reinterpret_cast<uint64_t>(m_bufferRing);
+    reg.ring_entries = count;
+    reg.bgid         = m_bufferGroup;
+    if (IoUringRegister(m_ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        munmap(m_bufferRing, m_bufferRingSize);
+        m_bufferRing = nullptr;
+        throw std::runtime_error("Failed to register io_uring buffer ring: " + std::string(strerror(errno)));
+    }
+
+    // Hand every buffer to the kernel
+    for (unsigned i = 0; i < count; ++i)
+    {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+}
+
+void IoUring::recycleBuffer(uint16_t bufferId)
+{
+    // Entries start at the ring base, the tail overlays the reserved field of entry 0. Not through
+    // bufs: __DECLARE_FLEX_ARRAY places it at offset 8 when compiled as C++.
+    io_uring_buf &buf = reinterpret_cast<io_uring_buf *>(m_bufferRing)[m_bufferTail & m_bufferMask];
+    buf.addr          = reinterpret_cast<uint64_t>(m_buffers.data() + static_cast<size_t>(bufferId) * m_bufferSize);
+    buf.len           = m_bufferSize;
+    buf.bid           = bufferId;
+    ++m_bufferTail;
+    __atomic_store_n(&m_bufferRing->tail, m_bufferTail, __ATOMIC_RELEASE);
+}
+
+bool IoUring::prepAccept(int fd, uint64_t userData)
+{
+    // Multishot: one request keeps posting a completion per accepted connection
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        return false;
+    }
+    sqe->opcode       = IORING_OP_ACCEPT;
+    sqe->fd           = fd;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data    = userData;
+    return true;
+}
+
+bool IoUring::prepRecv(int fd, uint64_t userData)
+{
+    // Multishot recv, the kernel picks a provided buffer for each completion
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        return false;
+    }
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = m_bufferGroup;
+    sqe->user_data = userData;
+    return true;
+}
+
+bool IoUring::prepSendmsg(int fd, const msghdr *msg, uint64_t userData)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        return false;
+    }
+    sqe->opcode    = IORING_OP_SENDMSG;
+    sqe->fd        = fd;
+    sqe->addr      = reinterpret_cast<uint64_t>(msg);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData;
+    return true;
+}
+
+bool IoUring::prepPoll(int fd, uint32_t events, bool multishot, uint64_t userData)
+{
+    io_uring_sqe *sqe  = getSqe();
+    if (!sqe)
+    {
+        return false;
+    }
+    sqe->opcode        = IORING_OP_POLL_ADD;
+    sqe->fd            = fd;
+    sqe->poll32_events = events;
+    sqe->len           = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data     = userData;
+    return true;
+}
+
+bool IoUring::prepCancel(uint64_t targetUserData)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+    {
+        return false;
+    }
+    sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+    sqe->addr         = targetUserData;
+    sqe->user_data    = 0;
+    return true;
+}
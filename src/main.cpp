@@ -27,9 +27,26 @@ int main()
     // TEST
     TEST();
 
-    // Register message handlers
-    NetworkManager::instance()->addMessageHandler(MsgType::LOGIN_REQUEST, HandleLoginRequest);
-    NetworkManager::instance()->addMessageHandler(MsgType::SIGN_UP_REQUEST, HandleSignUpRequest);
+    // Register message handlers, sign-ups are shed before logins under overload and both are rate limited
+    MsgTypeOptions loginOptions;
+    loginOptions.priority    = PRIORITY_LOGIN;
+    loginOptions.rateLimited = true;
+    MsgTypeOptions signUpOptions;
+    signUpOptions.priority    = PRIORITY_SIGN_UP;
+    signUpOptions.rateLimited = true;
+    NetworkManager::instance()->setInvalidMessageHandler(SendInvalidMessageError);
+    NetworkManager::instance()->setBusyHandler(SendServerBusyError);
+    NetworkManager::instance()->registerAsyncHandler<msg::LoginRequest, msg::LoginResponse>(
+        MsgType::LOGIN_REQUEST, MsgType::LOGIN_RESPONSE, HandleLoginRequest, loginOptions);
+    NetworkManager::instance()->registerAsyncHandler<msg::SignUpRequest, msg::SignUpResponse>(
+        MsgType::SIGN_UP_REQUEST, MsgType::SIGN_UP_RESPONSE, HandleSignUpRequest, signUpOptions);
+
+    // SECURETALK_IO_BACKEND=io_uring runs the reactors on io_uring where the kernel supports it, epoll otherwise
+    const char *ioBackend = getenv("SECURETALK_IO_BACKEND");
+    if (ioBackend && std::string(ioBackend) == "io_uring")
+    {
+        NetworkManager::instance()->setIoBackend(NetworkManager::IoBackend::IO_URING);
+    }
 
     // Start the network manager
     NetworkManager::instance()->start(7777);
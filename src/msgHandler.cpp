@@ -2,46 +2,46 @@
 
 #include "databaseManager.h"
 #include "logManager.h"
-#include "msg.pb.h"
-#include "msg_header.pb.h"
+#include "networkManager.h"
 #include "networkMsg.h"
 
 #include <iostream>
 
-msg_header::ServerMsgHeader GetServerMsgHeader()
+void FillServerMsgHeader(msg_header::ServerMsgHeader *header)
 {
-    msg_header::ServerMsgHeader header;
-    header.set_timestamp(
+    // Filled in place, the header lives wherever its message does
+    header->set_timestamp(
         std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
-    return header;
 }
 
-std::tuple<ClientID, MsgType, std::string> GetInvalidMessageErrorResponse(const ClientID &client)
+void SendInvalidMessageError(const ClientID &client)
 {
     msg::InvalidMessageError invalidMsgError;
-    invalidMsgError.mutable_header()->CopyFrom(GetServerMsgHeader());
+    FillServerMsgHeader(invalidMsgError.mutable_header());
     std::string msg;
     invalidMsgError.SerializeToString(&msg);
-    return std::make_tuple(client, MsgType::INVALID_MESSAGE_ERROR, msg);
+    SendMessage(client, MsgType::INVALID_MESSAGE_ERROR, std::move(msg));
 }
 
-std::tuple<ClientID, MsgType, std::string> HandleLoginRequest(const ClientID &client, const std::string &message)
+void SendServerBusyError(const ClientID &client, [[maybe_unused]] MsgType msgType)
 {
-    // Parse the message using protobuf
-    msg::LoginRequest loginReq;
-    if (!loginReq.ParseFromString(message))
-    {
-        LOG_ERROR(networkLogger, "Failed to parse login request");
-        return GetInvalidMessageErrorResponse(client);
-    }
+    // Same body as the invalid message error, the client retries the request later
+    msg::InvalidMessageError busyError;
+    FillServerMsgHeader(busyError.mutable_header());
+    std::string msg;
+    busyError.SerializeToString(&msg);
+    SendMessage(client, MsgType::SERVER_BUSY_ERROR, std::move(msg));
+}
 
-    // Check credentials
+AsyncTask<void> HandleLoginRequest([[maybe_unused]] ClientID client, const msg::LoginRequest &loginReq,
+                                   msg::LoginResponse &loginResp)
+{
+    // Check credentials on the database executor, the worker is free meanwhile
     DatabaseManager::ResultCode result =
-        DatabaseManager::instance()->authenticateUser(loginReq.username(), loginReq.password());
+        co_await DatabaseManager::instance()->authenticateUserAsync(loginReq.username(), loginReq.password());
 
     // Prepare response
-    msg::LoginResponse loginResp;
-    loginResp.mutable_header()->CopyFrom(GetServerMsgHeader());
+    FillServerMsgHeader(loginResp.mutable_header());
     if (result == DatabaseManager::SUCCESS)
     {
         loginResp.set_state(msg::LoginResponse::USER_VERIFICATION_SUCCESS);
@@ -54,29 +54,18 @@ std::tuple<ClientID, MsgType, std::string> HandleLoginRequest(const ClientID &cl
         loginResp.set_session_id("");
         LOG_INFO(networkLogger, "Login failed: " + loginReq.username());
     }
-    std::string msg;
-    loginResp.SerializeToString(&msg);
-
-    return std::make_tuple(client, MsgType::LOGIN_RESPONSE, msg);
+    co_return;
 }
 
-std::tuple<ClientID, MsgType, std::string> HandleSignUpRequest(const ClientID &client, const std::string &message)
+AsyncTask<void> HandleSignUpRequest([[maybe_unused]] ClientID client, const msg::SignUpRequest &signUpReq,
+                                    msg::SignUpResponse &signUpResp)
 {
-    // Parse the message using protobuf
-    msg::SignUpRequest signUpReq;
-    if (!signUpReq.ParseFromString(message))
-    {
-        LOG_ERROR(networkLogger, "Failed to parse sign up request");
-        return GetInvalidMessageErrorResponse(client);
-    }
-
-    // Try to create the user
+    // Try to create the user on the database executor
     DatabaseManager::ResultCode result =
-        DatabaseManager::instance()->createUser(signUpReq.username(), signUpReq.password());
+        co_await DatabaseManager::instance()->createUserAsync(signUpReq.username(), signUpReq.password());
 
     // Prepare response
-    msg::SignUpResponse signUpResp;
-    signUpResp.mutable_header()->CopyFrom(GetServerMsgHeader());
+    FillServerMsgHeader(signUpResp.mutable_header());
     if (result == DatabaseManager::SUCCESS)
     {
         signUpResp.set_state(msg::SignUpResponse::USER_CREATED);
@@ -92,8 +81,5 @@ std::tuple<ClientID, MsgType, std::string> HandleSignUpRequest(const ClientID &c
         signUpResp.set_state(msg::SignUpResponse::USER_CREATE_FAILED);
         LOG_INFO(networkLogger, "Sign up failed: " + signUpReq.username());
     }
-    std::string msg;
-    signUpResp.SerializeToString(&msg);
-
-    return std::make_tuple(client, MsgType::SIGN_UP_RESPONSE, msg);
-}
\ No newline at end of file
+    co_return;
+}
@@ -1,11 +1,25 @@
 #include "networkManager.h"
 #include "logManager.h"
 
-uint64_t GenerateToken()
+bool LowOnMemory()
 {
-    static std::mt19937_64                         rng(std::random_device{}());
-    static std::uniform_int_distribution<uint64_t> dist;
-    return dist(rng);
+    // Less than a tenth of the memory is available without swapping
+    std::ifstream meminfo("/proc/meminfo");
+    std::string   key;
+    uint64_t      value, total = 0, available = 0;
+    while (meminfo >> key >> value && (total == 0 || available == 0))
+    {
+        meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (key == "MemTotal:")
+        {
+            total = value;
+        }
+        else if (key == "MemAvailable:")
+        {
+            available = value;
+        }
+    }
+    return total != 0 && available < total / 10;
 }
 
 NetworkManager::NetworkManager() {}
@@ -13,35 +27,27 @@ NetworkManager::NetworkManager() {}
 NetworkManager::~NetworkManager()
 {
     // Stop the thread pool
-    m_threadPoolStop = true;
-    m_condition.notify_all();
-    for (auto &worker : m_workers)
-    {
-        if (worker.joinable())
-        {
-            worker.join();
-        }
-    }
+    m_workerPool.stop();
 
-    // Close all client connections
-    for (auto &pair : m_ClientIDToEpollData)
+    for (auto &reactor : m_reactors)
     {
-        closeConnection(pair.second);
-    }
-
-    // Clear message queues
-    {
-        std::lock_guard<std::mutex> lock(m_readMessageQueueMutex);
-        while (!m_readMessageQueue.empty())
+        // Close all client connections
+        for (uint32_t slot = 0; slot < reactor->connectionPool.slotCount(); ++slot)
         {
-            m_readMessageQueue.pop();
+            EpollData *data = reactor->connectionPool.at(slot);
+            if (data && data->clientID.value != 0)
+            {
+                closeConnection(data);
+            }
         }
-    }
-    {
-        std::lock_guard<std::mutex> lock(m_sendMessageQueueMutex);
-        while (!m_sendMessageQueue.empty())
+
+        // Clear send message queue
         {
-            m_sendMessageQueue.pop();
+            std::lock_guard<std::mutex> lock(reactor->sendMessageQueueMutex);
+            while (!reactor->sendMessageQueue.empty())
+            {
+                reactor->sendMessageQueue.pop();
+            }
         }
     }
 }
@@ -56,21 +62,170 @@ NetworkManager *NetworkManager::instance()
     return instance;
 }
 
+void NetworkManager::throwIfStarted(const char *what) const
+{
+    // Reactors and workers read the configuration without locking once the server runs
+    if (m_started)
+    {
+        std::string message = std::string(what) + " cannot be changed after start";
+        LOG_ERROR(networkLogger, message);
+        throw std::runtime_error(message);
+    }
+}
+
 void NetworkManager::setPort(uint32_t port)
 {
     m_port = port;
 }
 
-void NetworkManager::addMessageHandler(
-    MsgType                                                                                         msgType,
-    std::function<std::tuple<ClientID, MsgType, std::string>(ClientID client, const std::string &)> handler)
+void NetworkManager::addMessageHandler(MsgType msgType, MsgHandler handler, const MsgTypeOptions &options)
+{
+    // Adapt the string based handler, its reply tuple is sent if not empty
+    addRawMessageHandler(
+        msgType,
+        [handler](const ClientID &client, const char *body, size_t size) {
+            std::tuple<ClientID, MsgType, std::string> response = handler(client, std::string(body, size));
+            if (std::get<2>(response).size())
+            {
+                SendMessage(std::get<0>(response), std::get<1>(response), std::move(std::get<2>(response)));
+            }
+        },
+        options);
+}
+
+void NetworkManager::addRawMessageHandler(MsgType msgType, RawMsgHandler handler, const MsgTypeOptions &options)
 {
-    m_msgHandlers[msgType] = handler;
+    // Workers read the table without locking, so it is frozen once the server runs
+    throwIfStarted("Message handlers");
+    if (static_cast<size_t>(msgType) >= kMsgTypeCount)
+    {
+        LOG_ERROR(networkLogger, "Invalid message type: " + std::to_string(static_cast<unsigned int>(msgType)));
+        throw std::runtime_error("Invalid message type");
+    }
+    MsgHandlerEntry &entry = m_msgHandlers[static_cast<size_t>(msgType)];
+    entry                  = {std::move(handler), options};
+    if (entry.options.priority == PRIORITY_BY_TYPE)
+    {
+        entry.options.priority = DefaultMsgPriority(msgType);
+    }
 }
 
 void NetworkManager::removeMessageHandler(MsgType msgType)
 {
-    m_msgHandlers.erase(msgType);
+    throwIfStarted("Message handlers");
+    if (static_cast<size_t>(msgType) < kMsgTypeCount)
+    {
+        m_msgHandlers[static_cast<size_t>(msgType)] = MsgHandlerEntry();
+    }
+}
+
+void NetworkManager::setInvalidMessageHandler(std::function<void(const ClientID &client)> handler)
+{
+    throwIfStarted("Message handlers");
+    m_invalidMessageHandler = std::move(handler);
+}
+
+void NetworkManager::setBusyHandler(std::function<void(const ClientID &client, MsgType msgType)> handler)
+{
+    throwIfStarted("Message handlers");
+    m_busyHandler = std::move(handler);
+}
+
+google::protobuf::Arena &NetworkManager::requestArena()
+{
+    // The initial block is caller owned, so Reset() keeps it and small requests never reach malloc
+    thread_local char                    initialBlock[kRequestArenaBlockSize];
+    thread_local google::protobuf::Arena arena([] {
+        google::protobuf::ArenaOptions options;
+        options.initial_block      = initialBlock;
+        options.initial_block_size = sizeof(initialBlock);
+        return options;
+    }());
+    return arena;
+}
+
+NetworkManager::AsyncRequest::AsyncRequest(WorkerPool &workerPool, const ClientID &client)
+    : arena([this] {
+          google::protobuf::ArenaOptions options;
+          options.initial_block      = initialBlock;
+          options.initial_block_size = sizeof(initialBlock);
+          return options;
+      }()),
+      workerPool(workerPool), client(client)
+{
+    workerPool.holdClient(client);
+}
+
+NetworkManager::AsyncRequest::~AsyncRequest()
+{
+    workerPool.releaseClient(client);
+}
+
+void NetworkManager::setReactorCount(size_t count)
+{
+    throwIfStarted("Reactor count");
+    m_reactorCount = count;
+}
+
+void NetworkManager::setMaxAcceptsPerLoop(size_t maxAccepts)
+{
+    throwIfStarted("Accept budget");
+    m_maxAcceptsPerLoop = std::max<size_t>(1, maxAccepts);
+}
+
+void NetworkManager::setIoBackend(IoBackend backend)
+{
+    throwIfStarted("I/O backend");
+    m_ioBackend = backend;
+}
+
+void NetworkManager::setWriteWatermarks(size_t high, size_t low, size_t limit)
+{
+    throwIfStarted("Write watermarks");
+    if (low > high)
+    {
+        LOG_ERROR(networkLogger, "Low write watermark must not exceed the high watermark");
+        throw std::runtime_error("Low write watermark must not exceed the high watermark");
+    }
+    if (limit < high)
+    {
+        LOG_ERROR(networkLogger, "Write queue limit must not be below the high watermark");
+        throw std::runtime_error("Write queue limit must not be below the high watermark");
+    }
+    m_writeHighWatermark = high;
+    m_writeLowWatermark  = low;
+    m_writeQueueLimit    = limit;
+}
+
+void NetworkManager::setBackpressureHandler(std::function<void(const ClientID &client, bool paused)> handler)
+{
+    throwIfStarted("Backpressure handler");
+    m_backpressureHandler = std::move(handler);
+}
+
+void NetworkManager::setDropHandler(std::function<void(const ClientID &client, MsgType msgType)> handler)
+{
+    throwIfStarted("Drop handler");
+    m_dropHandler = std::move(handler);
+}
+
+void NetworkManager::setOverloadControl(std::chrono::microseconds target, std::chrono::milliseconds interval,
+                                        size_t maxQueueDepth)
+{
+    throwIfStarted("Overload control");
+    m_admissionControl.configure(target, interval, maxQueueDepth);
+}
+
+void NetworkManager::setConnectionRateLimit(double perSecond, double burst)
+{
+    throwIfStarted("Rate limits");
+    m_connectionRateLimiter.configure(perSecond, burst);
+}
+
+void NetworkManager::setLoginRateLimit(double perSecond, double burst)
+{
+    throwIfStarted("Rate limits");
+    m_loginRateLimiter.configure(perSecond, burst);
 }
 
 void NetworkManager::start(uint32_t port)
@@ -81,19 +236,69 @@ void NetworkManager::start(uint32_t port)
         m_port = port;
     }
 
-    // Create server socket
-    m_serverFd = socket(AF_INET, SOCK_STREAM, 0);
-    if (m_serverFd == -1)
+    // Determine the number of reactors
+    if (m_reactorCount == 0)
+    {
+        m_reactorCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // The reactor index has to fit into a ClientID
+    if (m_reactorCount > ClientID::kMaxReactors)
+    {
+        LOG_WARN(networkLogger, "Limiting reactor count to " + std::to_string(ClientID::kMaxReactors));
+        m_reactorCount = ClientID::kMaxReactors;
+    }
+
+    // Freeze the dispatch table, reactors and workers read it from now on
+    m_started = true;
+
+    // io_uring needs a recent kernel and may be disabled, fall back to epoll then
+    if (m_ioBackend == IoBackend::IO_URING && !IoUring::isSupported())
+    {
+        LOG_WARN(networkLogger, "io_uring is not available, falling back to epoll");
+        m_ioBackend = IoBackend::EPOLL;
+    }
+
+    // Create reactors, each with its own listening socket and event loop
+    for (size_t i = 0; i < m_reactorCount; ++i)
+    {
+        auto reactor   = std::make_unique<Reactor>();
+        reactor->index = static_cast<uint32_t>(i);
+        initReactor(*reactor);
+        m_reactors.push_back(std::move(reactor));
+    }
+
+    // Initialize thread pool
+    initThreadPool();
+
+    LOG_INFO(networkLogger, "Server started on port " + std::to_string(m_port) + " with " +
+                                std::to_string(m_reactorCount) + " reactor(s) using " +
+                                (m_ioBackend == IoBackend::IO_URING ? "io_uring" : "epoll"));
+
+    // Run reactor 0 on the calling thread, the others on their own threads
+    for (size_t i = 1; i < m_reactors.size(); ++i)
+    {
+        Reactor &reactor = *m_reactors[i];
+        reactor.thread   = std::thread([this, &reactor]() { runReactor(reactor); });
+    }
+    runReactor(*m_reactors[0]);
+}
+
+void NetworkManager::initReactor(Reactor &reactor)
+{
+    // Create server socket, non-blocking so the accept loop can stop at EAGAIN
+    reactor.serverFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (reactor.serverFd == -1)
     {
         LOG_ERROR(networkLogger, "Failed to create socket");
         throw std::runtime_error("Failed to create socket");
     }
 
-    // Set socket options: SO_REUSEPORT
+    // Set socket options: SO_REUSEPORT, so every reactor can bind the same port
     int opt = 1;
-    if (setsockopt(m_serverFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    if (setsockopt(reactor.serverFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
     {
-        close(m_serverFd);
+        close(reactor.serverFd);
         LOG_ERROR(networkLogger, "Set socket option SO_REUSEPORT failed");
         throw std::runtime_error("Set socket option SO_REUSEPORT failed");
     }
@@ -103,53 +308,88 @@ void NetworkManager::start(uint32_t port)
     serverAddr.sin_family      = AF_INET;
     serverAddr.sin_addr.s_addr = INADDR_ANY;
     serverAddr.sin_port        = htons(m_port);
-    if (bind(m_serverFd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) == -1)
+    if (bind(reactor.serverFd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) == -1)
     {
-        close(m_serverFd);
+        close(reactor.serverFd);
         LOG_ERROR(networkLogger, "Failed to bind socket");
         throw std::runtime_error("Failed to bind socket");
     }
 
-    // Create epoll instance
-    m_epollFd = epoll_create1(0);
-    if (m_epollFd == -1)
+    // Create wakeup eventfd, so worker threads can interrupt the reactor when they queue outbound data
+    reactor.wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor.wakeupFd == -1)
     {
-        close(m_serverFd);
-        LOG_ERROR(networkLogger, "Failed to create epoll instance");
-        throw std::runtime_error("Failed to create epoll instance");
+        close(reactor.serverFd);
+        LOG_ERROR(networkLogger, "Failed to create wakeup eventfd");
+        throw std::runtime_error("Failed to create wakeup eventfd");
     }
 
-    // Add server socket to epoll
-    struct epoll_event event;
-    event.events  = EPOLLIN;
-    event.data.fd = m_serverFd;
-    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_serverFd, &event) == -1)
+    // The io_uring ring is created by the reactor thread itself, it must be the only submitter
+    if (m_ioBackend == IoBackend::EPOLL)
     {
-        close(m_serverFd);
-        LOG_ERROR(networkLogger, "Failed to add server socket to epoll");
-        throw std::runtime_error("Failed to add server socket to epoll");
-    }
-    struct epoll_event events[m_maxEpollEvents];
+        // Create epoll instance
+        reactor.epollFd = epoll_create1(0);
+        if (reactor.epollFd == -1)
+        {
+            close(reactor.serverFd);
+            LOG_ERROR(networkLogger, "Failed to create epoll instance");
+            throw std::runtime_error("Failed to create epoll instance");
+        }
 
-    // Initialize heartbeat check time
-    lastCheckHeartbeatTime = std::chrono::steady_clock::now();
+        // Add server socket to epoll. Connections are tagged with their EpollData pointer, so the
+        // listener and the eventfd are tagged with pointers too: a pointer's low bits may equal an fd.
+        struct epoll_event event;
+        event.events   = EPOLLIN;
+        event.data.ptr = &reactor.serverFd;
+        if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.serverFd, &event) == -1)
+        {
+            close(reactor.serverFd);
+            LOG_ERROR(networkLogger, "Failed to add server socket to epoll");
+            throw std::runtime_error("Failed to add server socket to epoll");
+        }
 
-    // Initialize thread pool
-    initThreadPool();
+        // Add wakeup eventfd to epoll
+        event.events   = EPOLLIN;
+        event.data.ptr = &reactor.wakeupFd;
+        if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.wakeupFd, &event) == -1)
+        {
+            close(reactor.serverFd);
+            LOG_ERROR(networkLogger, "Failed to add wakeup eventfd to epoll");
+            throw std::runtime_error("Failed to add wakeup eventfd to epoll");
+        }
+    }
 
     // Start listening
-    if (listen(m_serverFd, SOMAXCONN) == -1)
+    if (listen(reactor.serverFd, SOMAXCONN) == -1)
     {
-        close(m_serverFd);
+        close(reactor.serverFd);
         LOG_ERROR(networkLogger, "Failed to start listening on socket");
         throw std::runtime_error("Failed to start listening on socket");
     }
-    LOG_INFO(networkLogger, "Server started on port " + std::to_string(m_port));
 
-    size_t clientCounter = 0;
+    // Initialize client count report time
+    reactor.lastClientCountReportTime = std::chrono::steady_clock::now();
+}
+
+void NetworkManager::runReactor(Reactor &reactor)
+{
+    if (m_ioBackend == IoBackend::IO_URING)
+    {
+        runUringReactor(reactor);
+    }
+    else
+    {
+        runEpollReactor(reactor);
+    }
+}
+
+void NetworkManager::runEpollReactor(Reactor &reactor)
+{
+    std::vector<epoll_event> events(m_maxEpollEvents);
+
     while (true)
     {
-        int nready = epoll_wait(m_epollFd, events, m_maxEpollEvents, 1000);
+        int nready = epoll_wait(reactor.epollFd, events.data(), m_maxEpollEvents, 1000);
         if (nready < 0)
         {
             if (errno == EINTR)
@@ -162,54 +402,15 @@ void NetworkManager::start(uint32_t port)
 
         for (int i = 0; i < nready; ++i)
         {
-            if (events[i].data.fd == m_serverFd)
+            if (events[i].data.ptr == &reactor.serverFd)
             {
-                // Accept new connection
-                sockaddr_in clientAddr;
-                socklen_t   clientAddrLen = sizeof(clientAddr);
-                int         clientFd      = accept(m_serverFd, (struct sockaddr *)&clientAddr, &clientAddrLen);
-                if (clientFd == -1)
-                {
-                    continue; // Accept failed, skip this iteration
-                }
-
-                // Create epoll event for new client socket
-                struct epoll_event clientEvent;
-
-                // Set up client event
-                clientEvent.events = EPOLLIN | EPOLLIN; // Edge-triggered
-
-                // Set up EpollData
-                EpollData *data      = new EpollData;
-                data->fd             = clientFd;
-                data->port           = ntohs(clientAddr.sin_port);
-                data->ip             = inet_ntoa(clientAddr.sin_addr);
-                data->lastActiveTime = std::chrono::steady_clock::now();
-                data->callback       = [this](epoll_event &event) { this->epollCallback(event); };
-                clientEvent.data.ptr = data;
-
-                // Set socket to non-blocking
-                int flags = fcntl(clientFd, F_GETFL, 0);
-                fcntl(clientFd, F_SETFL, flags | O_NONBLOCK);
-
-                // Add new client socket to epoll
-                if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, clientFd, &clientEvent) == -1)
-                {
-                    close(clientFd);
-                    continue; // Failed to add client socket to epoll, skip this iteration
-                }
-
-                // Map ClientID to EpollData
-                ClientID ClientIDKey;
-                ClientIDKey.acceptTime             = data->lastActiveTime;
-                ClientIDKey.randomValue            = GenerateToken();
-                m_ClientIDToEpollData[ClientIDKey] = data;
-
-                // Map EpollData to ClientID
-                m_EpollDataToClientID[data] = ClientIDKey;
-
-                LOG_INFO(networkLogger,
-                         "New connection from " + std::string(data->ip) + ":" + std::to_string(data->port));
+                acceptConnections(reactor);
+            }
+            else if (events[i].data.ptr == &reactor.wakeupFd)
+            {
+                // Drain the wakeup counter, the send message queue is processed below
+                eventfd_t value;
+                eventfd_read(reactor.wakeupFd, &value);
             }
             else
             {
@@ -217,102 +418,504 @@ void NetworkManager::start(uint32_t port)
                 events[i].data.ptr ? epollCallback(events[i]) : void();
             }
         }
-        // Process read message queue
+
+        processReactorQueues(reactor);
+    }
+}
+
+void NetworkManager::processReactorQueues(Reactor &reactor)
+{
+    // Process read message queue, only for connections that received data
+    for (EpollData *data : reactor.readyList)
+    {
+        data->inReadyList = false;
+        // Buffered frames of a paused connection wait, their replies would only grow its write queue
+        if (data->readPaused)
+        {
+            continue;
+        }
+        const ClientID clientID = data->clientID;
+        MsgType        msgType;
+        const char    *body;
+        uint32_t       size;
+        size_t         pongs = 0;
+        while (readMessage(data, msgType, body, size))
         {
-            std::lock_guard<std::mutex> lock(m_readMessageQueueMutex);
-            for (auto it : m_ClientIDToEpollData)
+            LOG_DEBUG(networkLogger, "Received message from " + peerName(data));
+            const MsgHandlerEntry *entry = findMsgHandler(msgType);
+            if (msgType == MsgType::HEARTBEAT && !(entry && entry->handler))
             {
-                EpollData  *data = it.second;
-                MsgType     msgType;
-                std::string msg;
-                while (readMessage(data, msgType, msg))
+                // Reading it already refreshed liveness, only a ping needs an answer
+                if (std::string_view(body, size) != *kPongPayload)
                 {
-                    LOG_DEBUG(networkLogger,
-                              "Received message from " + std::string(data->ip) + ":" + std::to_string(data->port));
-                    m_readMessageQueue.emplace(it.first, msgType, msg);
-                    m_condition.notify_one();
+                    ++pongs;
                 }
             }
+            else if (!entry || !entry->handler)
+            {
+                // Nothing would handle it, don't wake a worker just to drop it
+                LOG_WARN(networkLogger,
+                         "No handler for message type: " + std::to_string(static_cast<unsigned int>(msgType)));
+            }
+            else if (entry->options.rateLimited &&
+                !m_loginRateLimiter.tryAcquire(data->address, data->lastActiveTime))
+            {
+                // Peer is trying credentials too fast, answer busy without spending a worker on it
+                LOG_DEBUG(networkLogger, "Rate limited message type " +
+                                             std::to_string(static_cast<unsigned int>(msgType)) + " from " +
+                                             peerName(data));
+                if (m_busyHandler)
+                {
+                    m_busyHandler(clientID, msgType);
+                }
+            }
+            else if (entry->options.runInline)
+            {
+                // Cheap handler, parse straight from the read buffer and skip the worker pool hop
+                entry->handler(clientID, body, size);
+            }
+            else if (!m_admissionControl.admit(entry->options.priority, m_workerPool.queuedTasks()))
+            {
+                // Workers are overloaded: turn low-priority work away at once rather than let it wait
+                LOG_DEBUG(networkLogger, "Shed message type " + std::to_string(static_cast<unsigned int>(msgType)) +
+                                             " from " + peerName(data));
+                if (m_busyHandler)
+                {
+                    m_busyHandler(clientID, msgType);
+                }
+            }
+            else
+            {
+                // Workers get their own copy, the read buffer belongs to this reactor
+                m_workerPool.submit({clientID, msgType, std::string(body, size), {}, entry->options.priority, {}});
+            }
+
+            // Consume the processed frame, the bytes behind it stay where they are
+            data->readBuffer.retrieve(kFrameHeaderSize + size);
         }
-        // Process send message queue
+
+        // Answer pings once the frames are consumed, a failed write may close the connection
+        for (; pongs > 0 && findConnection(reactor, clientID); --pongs)
         {
-            std::lock_guard<std::mutex> lock(m_sendMessageQueueMutex);
-            while (!m_sendMessageQueue.empty())
-            {
-                auto pair = m_sendMessageQueue.front();
+            sendMessage(reactor, clientID, MsgType::HEARTBEAT, kPongPayload);
+        }
+    }
+    reactor.readyList.clear();
+
+    // Process send message queue: take it in one swap, so workers are not blocked while it is written out
+    {
+        std::lock_guard<std::mutex> lock(reactor.sendMessageQueueMutex);
+        reactor.sendMessageQueue.swap(reactor.sendingQueue);
+    }
+    while (!reactor.sendingQueue.empty())
+    {
+        auto pair = std::move(reactor.sendingQueue.front());
 
-                ClientID           clientID = std::get<0>(pair);
-                MsgType            msgType  = std::get<1>(pair);
-                const std::string &packet   = std::get<2>(pair);
+        ClientID clientID = std::get<0>(pair);
+        MsgType  msgType  = std::get<1>(pair);
 
-                sendMessage(clientID, msgType, packet);
+        sendMessage(reactor, clientID, msgType, std::move(std::get<2>(pair)));
 
-                m_sendMessageQueue.pop();
+        reactor.sendingQueue.pop();
+    }
+
+    // Expire heartbeat and idle-timeout deadlines that are due
+    auto now = std::chrono::steady_clock::now();
+    reactor.timingWheel.advance(now, [this](TimerNode *node) { onConnectionTimer(static_cast<EpollData *>(node)); });
+
+    // Report the number of clients
+    if (now - reactor.lastClientCountReportTime > clientCountReportInterval)
+    {
+        reactor.lastClientCountReportTime = now;
+        trimConnectionPool(reactor, now);
+        if (reactor.clientCounter != reactor.connectionCount)
+        {
+            reactor.clientCounter = reactor.connectionCount;
+            LOG_INFO(networkLogger, "Number of clients on reactor " + std::to_string(reactor.index) + ": " +
+                                        std::to_string(reactor.clientCounter));
+        }
+        LOG_DEBUG(networkLogger, "Direct writes on reactor " + std::to_string(reactor.index) + ": " +
+                                     std::to_string(reactor.directWriteCompletions.load()) + "/" +
+                                     std::to_string(reactor.directWriteAttempts.load()));
+        if (reactor.index == 0)
+        {
+            reportPriorityStats();
+        }
+    }
+}
+
+void NetworkManager::acceptConnections(Reactor &reactor)
+{
+    // Drain the accept queue, bounded so a connection storm can't starve established connections.
+    // The listener is level-triggered, whatever is left over is reported again on the next loop.
+    for (size_t accepted = 0; accepted < m_maxAcceptsPerLoop; ++accepted)
+    {
+        // Accept new connection, already non-blocking
+        sockaddr_in clientAddr;
+        socklen_t   clientAddrLen = sizeof(clientAddr);
+        int         clientFd      = accept4(reactor.serverFd, (struct sockaddr *)&clientAddr, &clientAddrLen,
+                                            SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                LOG_ERROR(networkLogger, "Failed to accept connection: " + std::string(strerror(errno)));
             }
+            return;
         }
 
-        // Check heartbeats and timeouts
-        if (std::chrono::steady_clock::now() - lastCheckHeartbeatTime > checkHeartbeatInterval)
+        addConnection(reactor, clientFd, clientAddr);
+    }
+}
+
+void NetworkManager::addConnection(Reactor &reactor, int clientFd, const sockaddr_in &clientAddr)
+{
+    // Refuse peers that reconnect faster than their bucket allows, before any state is set up for them
+    auto now = std::chrono::steady_clock::now();
+    if (!m_connectionRateLimiter.tryAcquire(clientAddr.sin_addr.s_addr, now))
+    {
+        LOG_DEBUG(networkLogger, "Connection rate limited: " + std::string(inet_ntoa(clientAddr.sin_addr)));
+        close(clientFd);
+        return;
+    }
+
+    // Set up EpollData, reusing a pooled one and its buffers when possible
+    EpollData *data = reactor.connectionPool.acquire();
+    if (data->slot >= ClientID::kMaxSlots)
+    {
+        LOG_ERROR(networkLogger, "Connection table of reactor " + std::to_string(reactor.index) + " is full");
+        close(clientFd);
+        releaseConnection(data);
+        return;
+    }
+    data->reactor        = &reactor;
+    data->fd             = clientFd;
+    data->port           = ntohs(clientAddr.sin_port);
+    data->address        = clientAddr.sin_addr.s_addr;
+    data->lastActiveTime = now;
+
+    // Start watching the client socket
+    if (!registerConnection(data))
+    {
+        close(clientFd);
+        releaseConnection(data);
+        return; // Failed to register client socket, skip this connection
+    }
+
+    // The handle points straight at the slot, a fresh generation (never zero) tells it from earlier connections
+    if (++reactor.lastGeneration == 0)
+    {
+        ++reactor.lastGeneration;
+    }
+    data->clientID = ClientID(reactor.index, reactor.lastGeneration, data->slot);
+    ++reactor.connectionCount;
+
+    // First heartbeat is due once the connection has been idle for activeTimeout
+    reactor.timingWheel.schedule(data, data->lastActiveTime + activeTimeout);
+
+    LOG_INFO(networkLogger, "New connection from " + peerName(data));
+}
+
+bool NetworkManager::registerConnection(EpollData *data)
+{
+    // io_uring: one multishot recv delivers every read until the connection is closed
+    if (m_ioBackend == IoBackend::IO_URING)
+    {
+        if (!data->reactor->ring->prepRecv(data->fd, uringUserData(data, UringOp::RECV)))
+        {
+            LOG_ERROR(networkLogger, "No io_uring submission entry to receive from " + peerName(data));
+            return false;
+        }
+        data->recvArmed = true;
+        ++data->pendingOps;
+        return true;
+    }
+
+    // epoll: add new client socket, edge-triggered since reads and writes always run until EAGAIN
+    struct epoll_event clientEvent;
+    clientEvent.events   = EPOLLIN | EPOLLET;
+    clientEvent.data.ptr = data;
+    data->interest       = clientEvent.events;
+    return epoll_ctl(data->reactor->epollFd, EPOLL_CTL_ADD, data->fd, &clientEvent) != -1;
+}
+
+bool NetworkManager::armWrite(EpollData *data)
+{
+    // io_uring: one-shot poll, only used when a SENDMSG came back with EAGAIN. Its completion queues the
+    // next SENDMSG, the ring never writes to the socket with writev.
+    if (m_ioBackend == IoBackend::IO_URING)
+    {
+        if (!data->reactor->ring->prepPoll(data->fd, POLLOUT, false, uringUserData(data, UringOp::SEND_READY)))
         {
-            LOG_DEBUG(networkLogger, "Checking heartbeats and timeouts");
+            // Nothing would ever flush the queue, drop the connection rather than leave it hanging
+            LOG_ERROR(networkLogger, "No io_uring submission entry to wait for " + peerName(data));
+            closeConnection(data);
+            return false;
+        }
+        ++data->pendingOps;
+        return true;
+    }
+
+    // epoll: let epoll report when the rest can be written
+    updateInterest(data);
+    return true;
+}
 
-            lastCheckHeartbeatTime = std::chrono::steady_clock::now();
-            std::vector<EpollData *> clientsToClose;
-            for (const auto &pair : m_ClientIDToEpollData)
+void NetworkManager::updateInterest(EpollData *data)
+{
+    // The mask only changes when reading pauses or resumes, and when the write queue starts or stops
+    // waiting for the socket. Adding an event to an edge-triggered fd reports it at once if it is ready.
+    uint32_t interest = EPOLLET | (data->readPaused ? 0u : static_cast<uint32_t>(EPOLLIN)) |
+                        (data->writeQueue.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    if (interest == data->interest)
+    {
+        return;
+    }
+
+    epoll_event event;
+    event.events   = interest;
+    event.data.ptr = data;
+    if (epoll_ctl(data->reactor->epollFd, EPOLL_CTL_MOD, data->fd, &event) == -1)
+    {
+        LOG_ERROR(networkLogger, "Failed to modify fd " + std::to_string(data->fd) + ": " + strerror(errno));
+        return;
+    }
+    data->interest = interest;
+}
+
+bool NetworkManager::flushWriteQueue(EpollData *data)
+{
+    while (!data->writeQueue.empty())
+    {
+        // Flush queued frames in one writev, the queue advances by offset
+        ssize_t n = data->writeQueue.writeFd(data->fd);
+        if (n > 0)
+        {
+            continue;
+        }
+        else
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
             {
-                const ClientID &clientID = pair.first;
-                // Check connection timeout
-                if (pair.second->lastActiveTime + connectionTimeout < std::chrono::steady_clock::now())
-                {
-                    // Close inactive connections
-                    LOG_INFO(networkLogger, "Connection timeout for " + std::string(pair.second->ip) + ":" +
-                                                std::to_string(pair.second->port));
-                    clientsToClose.push_back(pair.second);
-                    continue;
-                }
-                // Check active timeout
-                else if (pair.second->lastActiveTime + activeTimeout < std::chrono::steady_clock::now())
-                {
-                    // Send heartbeat messages
-                    SendMessage(clientID, MsgType::HEARTBEAT, "ping");
-                }
+                break;
             }
-            for (auto *data : clientsToClose)
+            else
             {
+                LOG_ERROR(networkLogger, "Error writing to socket: " + std::string(strerror(errno)));
                 closeConnection(data);
+                return false;
             }
+        }
+    }
+    return true;
+}
+
+void NetworkManager::pauseReading(EpollData *data)
+{
+    data->readPaused = true;
+    if (m_ioBackend == IoBackend::IO_URING)
+    {
+        // Not re-armed while paused, bytes already in flight still land in the read buffer
+        if (!data->reactor->ring->prepCancel(uringUserData(data, UringOp::RECV)))
+        {
+            LOG_ERROR(networkLogger, "No io_uring submission entry to pause " + peerName(data));
+        }
+    }
+    else
+    {
+        // The write queue is not empty, so only writability is left to watch
+        updateInterest(data);
+    }
+
+    LOG_DEBUG(networkLogger, "Paused reading from " + peerName(data) + ", " +
+                                 std::to_string(data->writeQueue.queuedBytes()) + " bytes unsent");
+    if (m_backpressureHandler)
+    {
+        m_backpressureHandler(data->clientID, true);
+    }
+}
 
-            if (clientCounter != m_ClientIDToEpollData.size())
+bool NetworkManager::resumeReading(EpollData *data)
+{
+    data->readPaused = false;
+    if (m_ioBackend == IoBackend::IO_URING)
+    {
+        // A recv whose cancellation has not completed yet re-arms itself when it does
+        if (!data->recvArmed)
+        {
+            if (!data->reactor->ring->prepRecv(data->fd, uringUserData(data, UringOp::RECV)))
             {
-                clientCounter = m_ClientIDToEpollData.size();
-                LOG_INFO(networkLogger, "Number of clients: " + std::to_string(clientCounter));
+                LOG_ERROR(networkLogger, "No io_uring submission entry to resume " + peerName(data));
+                closeConnection(data);
+                return false;
             }
+            data->recvArmed = true;
+            ++data->pendingOps;
         }
     }
+    else
+    {
+        // Bytes that arrived while paused are reported as soon as EPOLLIN is back
+        updateInterest(data);
+    }
+
+    // Frames received before the pause have not been parsed yet
+    if (data->readBuffer.readableBytes() > 0 && !data->inReadyList)
+    {
+        data->inReadyList = true;
+        data->reactor->readyList.push_back(data);
+    }
+
+    LOG_DEBUG(networkLogger, "Resumed reading from " + peerName(data));
+    if (m_backpressureHandler)
+    {
+        m_backpressureHandler(data->clientID, false);
+    }
+    return true;
+}
+
+void NetworkManager::wakeupReactor(Reactor &reactor)
+{
+    if (eventfd_write(reactor.wakeupFd, 1) == -1 && errno != EAGAIN)
+    {
+        LOG_ERROR(networkLogger, "Failed to wake up reactor: " + std::string(strerror(errno)));
+    }
 }
 
 void NetworkManager::closeConnection(EpollData *data)
 {
     if (data)
     {
-        if (epoll_ctl(m_epollFd, EPOLL_CTL_DEL, data->fd, nullptr) == -1)
+        Reactor &reactor = *data->reactor;
+        if (m_ioBackend == IoBackend::IO_URING)
+        {
+            // Requests still in flight reference data, it is freed when the last one completes. Without a
+            // submission entry for the cancel, shutting the socket down ends them just the same.
+            if (!reactor.ring->prepCancel(uringUserData(data, UringOp::RECV)) ||
+                !reactor.ring->prepCancel(uringUserData(data, UringOp::SEND_READY)) ||
+                !reactor.ring->prepCancel(uringUserData(data, UringOp::SEND)))
+            {
+                shutdown(data->fd, SHUT_RDWR);
+            }
+            data->closing = true;
+            if (data->inSendList)
+            {
+                reactor.sendList.erase(std::find(reactor.sendList.begin(), reactor.sendList.end(), data));
+                data->inSendList = false;
+            }
+        }
+        else if (epoll_ctl(reactor.epollFd, EPOLL_CTL_DEL, data->fd, nullptr) == -1)
         {
             LOG_ERROR(networkLogger, "Failed to remove fd " + std::to_string(data->fd));
             return;
         }
-        m_ClientIDToEpollData.erase(m_EpollDataToClientID[data]);
-        m_EpollDataToClientID.erase(data);
+        if (data->inReadyList)
+        {
+            reactor.readyList.erase(std::find(reactor.readyList.begin(), reactor.readyList.end(), data));
+        }
+        reactor.timingWheel.cancel(data);
+        // Outstanding handles stop matching from here on, even while io_uring still holds the object
+        data->clientID = ClientID();
+        --reactor.connectionCount;
         close(data->fd);
-        LOG_INFO(networkLogger, "Closed connection to " + std::string(data->ip) + ":" + std::to_string(data->port));
-        delete data;
+        LOG_INFO(networkLogger, "Closed connection to " + peerName(data));
+        if (data->pendingOps == 0)
+        {
+            releaseConnection(data);
+        }
         data = nullptr;
     }
 }
 
+void NetworkManager::releaseConnection(EpollData *data)
+{
+    // Keep the buffers for the next connection unless one frame made them unusually large
+    if (data->readBuffer.capacity() > kMaxPooledBufferSize)
+    {
+        data->readBuffer.release();
+    }
+    data->readBuffer.retrieveAll();
+    data->writeQueue.clear();
+    data->interest    = 0;
+    data->inReadyList = false;
+    data->readPaused  = false;
+    data->recvArmed   = false;
+    data->closing     = false;
+    data->pendingOps  = 0;
+    data->reactor->connectionPool.release(data);
+}
+
+void NetworkManager::trimConnectionPool(Reactor &reactor, std::chrono::steady_clock::time_point now)
+{
+    // Only the reactor that moves the shared timestamp forward reads /proc/meminfo this interval
+    auto ticks      = now.time_since_epoch().count();
+    auto interval   = std::chrono::duration_cast<std::chrono::steady_clock::duration>(memoryCheckInterval).count();
+    auto last       = m_lastMemoryCheck.load(std::memory_order_relaxed);
+    bool memoryTurn = ticks - last >= interval &&
+                      m_lastMemoryCheck.compare_exchange_strong(last, ticks, std::memory_order_relaxed);
+
+    // Churn leaves idle connection objects behind, give their memory back once they clearly outnumber
+    // the live connections, or when the machine runs low on memory
+    SlabPool<EpollData> &pool = reactor.connectionPool;
+    if (pool.freeCount() <= reactor.connectionCount + kConnectionPoolSlack && !(memoryTurn && LowOnMemory()))
+    {
+        return;
+    }
+
+    size_t capacity = pool.capacity();
+    pool.trim([](EpollData &data) {
+        data.readBuffer.release();
+        data.writeQueue.release();
+    });
+    reactor.freeSends.clear();
+    malloc_trim(0);
+    LOG_INFO(networkLogger, "Trimmed connection pool of reactor " + std::to_string(reactor.index) + " from " +
+                                std::to_string(capacity) + " to " + std::to_string(pool.capacity()) + " objects");
+}
+
+void NetworkManager::onConnectionTimer(EpollData *data)
+{
+    // Activity only refreshes lastActiveTime, the deadline is re-derived from it here
+    auto now = std::chrono::steady_clock::now();
+
+    // Check connection timeout
+    if (data->lastActiveTime + connectionTimeout <= now)
+    {
+        // Close inactive connections
+        LOG_INFO(networkLogger, "Connection timeout for " + peerName(data));
+        closeConnection(data);
+    }
+    // Check active timeout
+    else if (data->lastActiveTime + activeTimeout <= now)
+    {
+        // Quiet connection: hand back the empty read buffer, the next read allocates it again. The write queue
+        // keeps its storage, the ping below would only allocate it again.
+        if (data->readBuffer.readableBytes() == 0)
+        {
+            data->readBuffer.release();
+        }
+
+        // Send heartbeat messages until the connection times out
+        SendMessage(data->clientID, MsgType::HEARTBEAT, kPingPayload);
+        data->reactor->timingWheel.schedule(data, std::min(now + heartbeatInterval,
+                                                           data->lastActiveTime + connectionTimeout));
+    }
+    // Connection was active since this deadline was armed
+    else
+    {
+        data->reactor->timingWheel.schedule(data, data->lastActiveTime + activeTimeout);
+    }
+}
+
 void NetworkManager::epollCallback(epoll_event &event)
 {
     EpollData *data     = static_cast<EpollData *>(event.data.ptr);
     const int  clientFd = data->fd;
+    bool       received = false;
 
     // Handle read event
     if (event.events & EPOLLIN)
@@ -320,15 +923,14 @@ void NetworkManager::epollCallback(epoll_event &event)
         // Update last active time
         data->lastActiveTime = std::chrono::steady_clock::now();
 
-        char buffer[4096];
         while (true)
         {
-            ssize_t n = read(clientFd, buffer, sizeof(buffer));
+            // Read straight into the connection's buffer
+            ssize_t n = data->readBuffer.readFd(clientFd);
             if (n > 0)
             {
-                data->readBuffer.append(std::string(buffer, n));
-                LOG_DEBUG(networkLogger, "Received " + std::to_string(n) + " bytes from " + std::string(data->ip) +
-                                             ":" + std::to_string(data->port));
+                received = true;
+                LOG_DEBUG(networkLogger, "Received " + std::to_string(n) + " bytes from " + peerName(data));
             }
             else if (n == 0)
             {
@@ -355,170 +957,348 @@ void NetworkManager::epollCallback(epoll_event &event)
     // Handle write event
     if (event.events & EPOLLOUT)
     {
-        while (!data->writeBuffer.empty())
+        if (!flushWriteQueue(data))
         {
-            ssize_t n = write(data->fd, data->writeBuffer.data(), data->writeBuffer.size());
-            if (n > 0)
-            {
-                data->writeBuffer.erase(0, n);
-            }
-            else
-            {
-                if (errno == EAGAIN || errno == EWOULDBLOCK)
-                {
-                    break;
-                }
-                else
-                {
-                    LOG_ERROR(networkLogger, "Error writing to socket: " + std::string(strerror(errno)));
-                    closeConnection(data);
-                    return;
-                }
-            }
+            return;
+        }
+        if (data->readPaused && data->writeQueue.queuedBytes() <= m_writeLowWatermark)
+        {
+            resumeReading(data);
         }
     }
 
-    // Trigger write event
-    event.events = event.events | EPOLLIN;
-    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, clientFd, &event);
+    // Queue the connection for frame parsing
+    if (received && !data->inReadyList)
+    {
+        data->inReadyList = true;
+        data->reactor->readyList.push_back(data);
+    }
+
+    // Keep watching for writes only while there is data left to send
+    updateInterest(data);
 }
 
-bool NetworkManager::readMessage(EpollData *data, MsgType &msgType, std::string &msg)
+bool NetworkManager::readMessage(EpollData *data, MsgType &msgType, const char *&body, uint32_t &size)
 {
-    // Loop to parse complete messages in the buffer
-    while (true)
+    ByteBuffer &buffer = data->readBuffer;
+
+    // Check if the buffer contains at least the message header (type + length)
+    if (buffer.readableBytes() < kFrameHeaderSize)
     {
-        // Check if the buffer contains at least the message header (type + length)
-        if (data->readBuffer.size() < sizeof(uint16_t) + sizeof(uint32_t))
+        // Incomplete data, wait for the next receive
+        return false;
+    }
+
+    // Read message type
+    uint16_t typeVal;
+    std::memcpy(&typeVal, buffer.peek(), sizeof(typeVal));
+    typeVal = ntohs(typeVal); // Convert from network byte order to host byte order
+
+    // Read message length
+    uint32_t msgLen;
+    std::memcpy(&msgLen, buffer.peek() + sizeof(typeVal), sizeof(msgLen));
+    msgLen = ntohl(msgLen); // Convert from network byte order to host byte order
+
+    // Reject oversized frames as soon as the header arrives, before buffering the body
+    const MsgHandlerEntry *entry        = findMsgHandler(static_cast<MsgType>(typeVal));
+    uint32_t               maxFrameSize = entry ? entry->options.maxFrameSize : MsgTypeOptions().maxFrameSize;
+    if (msgLen > maxFrameSize)
+    {
+        LOG_ERROR(networkLogger, "Frame of " + std::to_string(msgLen) + " bytes exceeds limit for message type " +
+                                     std::to_string(typeVal));
+        closeConnection(data);
+        return false;
+    }
+
+    // Check if the buffer contains the complete message body
+    if (buffer.readableBytes() < sizeof(typeVal) + sizeof(msgLen) + msgLen)
+    {
+        // Message not fully received yet, wait for more data
+        return false;
+    }
+
+    // Point at the message content, the caller retrieves the frame once it is handled
+    msgType = static_cast<MsgType>(typeVal);
+    body    = buffer.peek() + sizeof(typeVal) + sizeof(msgLen);
+    size    = msgLen;
+
+    // Successfully found one complete message
+    return true;
+}
+
+const NetworkManager::MsgHandlerEntry *NetworkManager::findMsgHandler(MsgType msgType) const
+{
+    // Unknown types from the wire fall outside the table
+    size_t index = static_cast<size_t>(msgType);
+    return index < kMsgTypeCount ? &m_msgHandlers[index] : nullptr;
+}
+
+std::string NetworkManager::peerName(const EpollData *data)
+{
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &data->address, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(data->port);
+}
+
+NetworkManager::EpollData *NetworkManager::findConnection(Reactor &reactor, const ClientID &clientID)
+{
+    // A closed connection's slot holds the empty ClientID, which must not match it
+    if (clientID.value == 0)
+    {
+        return nullptr;
+    }
+
+    // Direct index into the connection table, a stale generation means the connection is gone
+    EpollData *data = reactor.connectionPool.at(clientID.slot());
+    return data && data->clientID == clientID ? data : nullptr;
+}
+
+void NetworkManager::sendMessage(Reactor &reactor, const ClientID &clientID, MsgType msgType, SharedPayload msg)
+{
+    EpollData *data = findConnection(reactor, clientID);
+    // Client not found, possibly disconnected
+    if (!data)
+    {
+        LOG_WARN(networkLogger, "Client not found for message sending");
+        return;
+    }
+
+    // Paused reading does not stop replies and fan-out from other clients, the limit bounds those. A frame
+    // into an empty queue always goes, so no single message is refused for its size alone.
+    size_t frameSize = kFrameHeaderSize + msg->size();
+    if (!data->writeQueue.empty() && data->writeQueue.queuedBytes() + frameSize > m_writeQueueLimit)
+    {
+        LOG_WARN(networkLogger, "Dropped message type " + std::to_string(static_cast<unsigned int>(msgType)) + " to " +
+                                    peerName(data) + ", " + std::to_string(data->writeQueue.queuedBytes()) +
+                                    " bytes unsent");
+        if (m_dropHandler)
         {
-            // Incomplete data, wait for the next receive
-            break;
+            m_dropHandler(clientID, msgType);
         }
+        return;
+    }
 
-        // Read message type
-        uint16_t typeVal;
-        data->readBuffer.copy(reinterpret_cast<char *>(&typeVal), sizeof(typeVal), 0);
-        typeVal = ntohs(typeVal); // Convert from network byte order to host byte order
-        msgType = static_cast<MsgType>(typeVal);
-
-        // Read message length
-        uint32_t msgLen;
-        data->readBuffer.copy(reinterpret_cast<char *>(&msgLen), sizeof(msgLen), sizeof(typeVal));
-        msgLen = ntohl(msgLen); // Convert from network byte order to host byte order
+    // Queue header and body as one frame, the body is shared rather than copied into a packet
+    bool wasEmpty = data->writeQueue.empty();
+    data->writeQueue.push(msgType, std::move(msg));
 
-        // Check if the buffer contains the complete message body
-        if (data->readBuffer.size() < sizeof(typeVal) + sizeof(msgLen) + msgLen)
+    // A non-empty queue already waits for writability, the frame goes out behind the others
+    if (!wasEmpty)
+    {
+        // Slow reader: stop taking its requests until the queue drains to the low watermark
+        if (!data->readPaused && data->writeQueue.queuedBytes() > m_writeHighWatermark)
         {
-            // Message not fully received yet, wait for more data
-            break;
+            pauseReading(data);
         }
+        return;
+    }
 
-        // Extract message content
-        msg.assign(data->readBuffer.data() + sizeof(typeVal) + sizeof(msgLen), msgLen);
+    // io_uring: no direct write, the frame goes out as one SENDMSG with this iteration's submission
+    if (m_ioBackend == IoBackend::IO_URING)
+    {
+        queueUringSend(data);
+        if (!data->readPaused && data->writeQueue.queuedBytes() > m_writeHighWatermark)
+        {
+            pauseReading(data);
+        }
+        return;
+    }
 
-        // Remove the processed message from the buffer
-        data->readBuffer.erase(0, sizeof(typeVal) + sizeof(msgLen) + msgLen);
+    // Nothing else pending: try the socket right away before involving the event loop
+    reactor.directWriteAttempts.fetch_add(1, std::memory_order_relaxed);
+    ssize_t n = data->writeQueue.writeFd(data->fd);
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        LOG_ERROR(networkLogger, "Error writing to socket: " + std::string(strerror(errno)));
+        closeConnection(data);
+        return;
+    }
+    if (data->writeQueue.empty())
+    {
+        reactor.directWriteCompletions.fetch_add(1, std::memory_order_relaxed);
+        LOG_DEBUG(networkLogger, "Sent message to " + peerName(data));
+        return;
+    }
 
-        // Successfully extracted one complete message, exit function
-        return true;
+    // Kernel buffer is full, wait until the rest can be written
+    if (!armWrite(data))
+    {
+        return;
     }
-    return false;
+    if (data->writeQueue.queuedBytes() > m_writeHighWatermark)
+    {
+        pauseReading(data);
+    }
+
+    LOG_DEBUG(networkLogger, "Queued message to " + peerName(data));
 }
 
-void NetworkManager::sendMessage(const ClientID &clientID, MsgType msgType, const std::string &msg)
+uint64_t NetworkManager::directWriteAttempts() const
 {
-    // Prepare packet with header (type + length)
-    std::string packet;
-    uint16_t    typeVal = htons(static_cast<uint16_t>(msgType));
-    uint32_t    msgLen  = htonl(static_cast<uint32_t>(msg.size()));
-    packet.append(reinterpret_cast<const char *>(&typeVal), sizeof(typeVal));
-    packet.append(reinterpret_cast<const char *>(&msgLen), sizeof(msgLen));
-    packet.append(msg);
-
-    auto it = m_ClientIDToEpollData.find(clientID);
-    // Client found
-    if (it != m_ClientIDToEpollData.end())
+    uint64_t total = 0;
+    for (const auto &reactor : m_reactors)
     {
-        it->second->writeBuffer.append(packet);
-        // Trigger write event
-        epoll_event event;
-        event.events   = event.events | EPOLLOUT;
-        event.data.ptr = it->second;
-        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, it->second->fd, &event);
-
-        LOG_DEBUG(networkLogger,
-                  "Sent message to " + std::string(it->second->ip) + ":" + std::to_string(it->second->port));
+        total += reactor->directWriteAttempts.load(std::memory_order_relaxed);
     }
-    // Client not found, possibly disconnected
-    else
+    return total;
+}
+
+uint64_t NetworkManager::directWriteCompletions() const
+{
+    uint64_t total = 0;
+    for (const auto &reactor : m_reactors)
     {
-        LOG_WARN(networkLogger, "Client not found for message sending");
+        total += reactor->directWriteCompletions.load(std::memory_order_relaxed);
     }
+    return total;
+}
+
+uint64_t NetworkManager::shedMessages() const
+{
+    return m_admissionControl.shedCount();
+}
+
+WorkerPool::PriorityStats NetworkManager::priorityStats(uint8_t priority) const
+{
+    return m_workerPool.priorityStats(priority);
 }
 
 void NetworkManager::setMaxWorkerThreads(size_t maxThreads)
 {
+    throwIfStarted("Worker thread count");
     m_maxWorkerThreads = maxThreads;
 }
 
+void NetworkManager::setDispatchMode(WorkerPool::DispatchMode mode)
+{
+    throwIfStarted("Dispatch mode");
+    m_workerPool.setDispatchMode(mode);
+}
+
+void NetworkManager::setPriorityWeights(const std::array<unsigned, kPriorityCount> &weights)
+{
+    throwIfStarted("Priority weights");
+    m_workerPool.setPriorityWeights(weights);
+}
+
 void NetworkManager::initThreadPool()
 {
     // Determine the maximum number of worker threads
     if (m_maxWorkerThreads == 0)
     {
-        m_maxWorkerThreads = std::thread::hardware_concurrency();
+        m_maxWorkerThreads = std::max(1u, std::thread::hardware_concurrency());
     }
 
     // Create worker threads
-    for (size_t i = 0; i < m_maxWorkerThreads; ++i)
+    m_workerPool.start(m_maxWorkerThreads, [this](WorkerPool::Task &task) { dispatchMessage(task); });
+}
+
+void NetworkManager::dispatchMessage(WorkerPool::Task &task)
+{
+    // Feed the queueing delay to the admission control
+    auto now = std::chrono::steady_clock::now();
+    m_admissionControl.onDequeue(task.priority, now - task.enqueueTime, m_workerPool.queuedTasks(), now);
+
+    // Find message handler
+    const MsgHandlerEntry *entry = findMsgHandler(task.msgType);
+
+    // Messages queued before the overload was detected are shed here too, so the backlog drains quickly
+    if (!m_admissionControl.admit(entry ? entry->options.priority : 0, m_workerPool.queuedTasks()))
     {
-        m_workers.emplace_back([this]() {
-            while (true)
-            {
-                // Wait for tasks
-                std::tuple<ClientID, MsgType, std::string> task;
-                {
-                    std::unique_lock<std::mutex> lock(m_readMessageQueueMutex);
-                    m_condition.wait(lock, [this] { return m_threadPoolStop || !m_readMessageQueue.empty(); });
-                    if (m_threadPoolStop && m_readMessageQueue.empty()) return;
-                    task = std::move(m_readMessageQueue.front());
-                    m_readMessageQueue.pop();
-                }
-                // Find message handler
-                auto it = m_msgHandlers.find(std::get<1>(task));
-                if (it != m_msgHandlers.end())
-                {
-                    // Call the message handler
-                    std::tuple<ClientID, MsgType, std::string> response =
-                        it->second(std::get<0>(task), std::get<2>(task));
-
-                    // Check if response is unempty
-                    if (std::get<2>(response).size())
-                    {
-                        // Push response to send message queue
-                        std::unique_lock<std::mutex> lock(m_sendMessageQueueMutex);
-                        m_sendMessageQueue.push(response);
-                    }
-                }
-                else
-                {
-                    std::tuple<ClientID, MsgType, std::string> response{
-                        std::get<0>(task), MsgType::INVALID_MESSAGE_TYPE,
-                        "No handler for message type: " + std::to_string(static_cast<unsigned int>(std::get<1>(task)))};
+        if (m_busyHandler)
+        {
+            m_busyHandler(task.clientID, task.msgType);
+        }
+        return;
+    }
 
-                    LOG_WARN(networkLogger, "No handler for message type: " +
-                                                std::to_string(static_cast<unsigned int>(std::get<1>(task))));
-                }
-            }
-        });
+    if (entry && entry->handler)
+    {
+        // Call the message handler, it queues its own reply on the owning reactor
+        entry->handler(task.clientID, task.msg.data(), task.msg.size());
+    }
+    else
+    {
+        LOG_WARN(networkLogger,
+                 "No handler for message type: " + std::to_string(static_cast<unsigned int>(task.msgType)));
     }
 }
 
-void SendMessage(const ClientID &clientID, MsgType msgType, const std::string &msg)
+void NetworkManager::reportPriorityStats()
 {
-    std::tuple<ClientID, MsgType, std::string> response = std::make_tuple(clientID, msgType, msg);
+    // Depth and average wait of every priority that had traffic since the last report
+    for (size_t i = 0; i < kPriorityCount; ++i)
     {
-        std::unique_lock<std::mutex> lock(NetworkManager::instance()->m_sendMessageQueueMutex);
-        NetworkManager::instance()->m_sendMessageQueue.push(response);
+        WorkerPool::PriorityStats  stats    = m_workerPool.priorityStats(static_cast<uint8_t>(i));
+        WorkerPool::PriorityStats &reported = m_reportedPriorityStats[i];
+        uint64_t                   handled  = stats.handled - reported.handled;
+        if (stats.queued == 0 && handled == 0)
+        {
+            continue;
+        }
+        std::chrono::duration<double, std::milli> averageWait = stats.totalWait - reported.totalWait;
+        averageWait /= std::max<uint64_t>(1, handled);
+        LOG_INFO(networkLogger, "Worker queue priority " + std::to_string(i) + ": " + std::to_string(stats.queued) +
+                                    " queued, " + std::to_string(handled) + " handled, " +
+                                    std::to_string(averageWait.count()) + " ms average wait");
+        reported = stats;
     }
-}
\ No newline at end of file
+}
+
+void SendMessage(const ClientID &clientID, MsgType msgType, std::string msg)
+{
+    SendMessage(clientID, msgType, std::make_shared<const std::string>(std::move(msg)));
+}
+
+void SendMessage(const ClientID &clientID, MsgType msgType, SharedPayload msg)
+{
+    // Route the message to the reactor that owns the connection
+    NetworkManager *manager = NetworkManager::instance();
+    if (clientID.reactorIndex() >= manager->m_reactors.size())
+    {
+        LOG_WARN(networkLogger, "Reactor not found for message sending");
+        return;
+    }
+    NetworkManager::Reactor &reactor = *manager->m_reactors[clientID.reactorIndex()];
+
+    bool wasEmpty;
+    {
+        std::unique_lock<std::mutex> lock(reactor.sendMessageQueueMutex);
+        wasEmpty = reactor.sendMessageQueue.empty();
+        reactor.sendMessageQueue.emplace(clientID, msgType, std::move(msg));
+    }
+
+    // Only the first message queued since the reactor's last drain needs to wake it up
+    if (wasEmpty)
+    {
+        manager->wakeupReactor(reactor);
+    }
+}
+
+void SendMessage(const std::vector<ClientID> &clientIDs, MsgType msgType, SharedPayload msg)
+{
+    // Take each reactor's lock once and queue a reference for every recipient it owns
+    NetworkManager *manager = NetworkManager::instance();
+    for (auto &reactor : manager->m_reactors)
+    {
+        bool wasEmpty;
+        bool queued = false;
+        {
+            std::unique_lock<std::mutex> lock(reactor->sendMessageQueueMutex);
+            wasEmpty = reactor->sendMessageQueue.empty();
+            for (const ClientID &clientID : clientIDs)
+            {
+                if (clientID.reactorIndex() == reactor->index)
+                {
+                    reactor->sendMessageQueue.emplace(clientID, msgType, msg);
+                    queued = true;
+                }
+            }
+        }
+
+        if (queued && wasEmpty)
+        {
+            manager->wakeupReactor(*reactor);
+        }
+    }
+}
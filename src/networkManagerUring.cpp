@@ -0,0 +1,251 @@
+#include "logManager.h"
+#include "networkManager.h"
+
+void NetworkManager::runUringReactor(Reactor &reactor)
+{
+    // Created here, the reactor thread is the ring's only submitter
+    reactor.ring = std::make_unique<IoUring>(m_uringEntries, 0, m_uringBufferCount, m_uringBufferSize);
+
+    // Multishot accept and wakeup poll stay armed for the lifetime of the reactor
+    armReactorOp(reactor, UringOp::ACCEPT);
+    armReactorOp(reactor, UringOp::WAKEUP);
+
+    while (true)
+    {
+        // Everything queued since the last iteration goes to the kernel in this one call
+        int ret = reactor.ring->submitAndWait(1000);
+        if (ret < 0)
+        {
+            LOG_ERROR(networkLogger, "Failed to wait on io_uring: " + std::string(strerror(-ret)));
+            throw std::runtime_error("Failed to wait on io_uring");
+        }
+
+        reactor.ring->forEachCqe([this, &reactor](const io_uring_cqe &cqe) { handleUringCompletion(reactor, cqe); });
+
+        processReactorQueues(reactor);
+        submitUringSends(reactor);
+    }
+}
+
+void NetworkManager::armReactorOp(Reactor &reactor, UringOp op)
+{
+    bool queued = op == UringOp::ACCEPT
+                      ? reactor.ring->prepAccept(reactor.serverFd, uringUserData(nullptr, op))
+                      : reactor.ring->prepPoll(reactor.wakeupFd, POLLIN, true, uringUserData(nullptr, op));
+    if (!queued)
+    {
+        // Without these the reactor would never see another connection or queued message
+        LOG_ERROR(networkLogger, "No io_uring submission entry to arm reactor " + std::to_string(reactor.index));
+        throw std::runtime_error("Failed to arm io_uring reactor");
+    }
+}
+
+void NetworkManager::queueUringSend(EpollData *data)
+{
+    // A send in flight queues the next one from its completion, with whatever was pushed meanwhile
+    if (!data->inSendList && !data->send)
+    {
+        data->inSendList = true;
+        data->reactor->sendList.push_back(data);
+    }
+}
+
+void NetworkManager::submitUringSends(Reactor &reactor)
+{
+    // One SENDMSG per connection carries every frame queued for it during this iteration
+    for (EpollData *data : reactor.sendList)
+    {
+        data->inSendList = false;
+        if (reactor.freeSends.empty())
+        {
+            data->send = std::make_unique<UringSend>();
+        }
+        else
+        {
+            data->send = std::move(reactor.freeSends.back());
+            reactor.freeSends.pop_back();
+        }
+
+        UringSend &send     = *data->send;
+        send.msg.msg_iov    = send.vec;
+        send.msg.msg_iovlen    = data->writeQueue.gather(send.vec, send.headers);
+        if (!reactor.ring->prepSendmsg(data->fd, &send.msg, uringUserData(data, UringOp::SEND)))
+        {
+            // Nothing would ever flush the queue, drop the connection rather than leave it hanging
+            reactor.freeSends.push_back(std::move(data->send));
+            LOG_ERROR(networkLogger, "No io_uring submission entry to send to " + peerName(data));
+            closeConnection(data);
+            continue;
+        }
+        ++data->pendingOps;
+    }
+    reactor.sendList.clear();
+}
+
+void NetworkManager::handleUringCompletion(Reactor &reactor, const io_uring_cqe &cqe)
+{
+    UringOp    op       = static_cast<UringOp>(cqe.user_data & kUringOpMask);
+    EpollData *data     = reinterpret_cast<EpollData *>(cqe.user_data & ~kUringOpMask);
+    bool       finished = !(cqe.flags & IORING_CQE_F_MORE);
+
+    switch (op)
+    {
+    case UringOp::ACCEPT: {
+        // Unlike the epoll loop this takes no m_maxAcceptsPerLoop budget: the kernel posts one completion per
+        // connection, and one pass over the completion ring already interleaves them with client reads
+        if (cqe.res >= 0)
+        {
+            // Multishot accept does not report the peer address
+            sockaddr_in clientAddr{};
+            socklen_t   clientAddrLen = sizeof(clientAddr);
+            if (getpeername(cqe.res, (struct sockaddr *)&clientAddr, &clientAddrLen) == -1)
+            {
+                // Already reset by the peer, and without an address it cannot be rate limited
+                LOG_ERROR(networkLogger, "Failed to get peer address: " + std::string(strerror(errno)));
+                close(cqe.res);
+            }
+            else
+            {
+                addConnection(reactor, cqe.res, clientAddr);
+            }
+        }
+        else if (cqe.res != -ECONNABORTED && cqe.res != -EINTR)
+        {
+            LOG_ERROR(networkLogger, "Failed to accept connection: " + std::string(strerror(-cqe.res)));
+        }
+        if (finished)
+        {
+            armReactorOp(reactor, UringOp::ACCEPT);
+        }
+        break;
+    }
+    case UringOp::WAKEUP: {
+        // Drain the wakeup counter, the send message queue is processed after the completions
+        eventfd_t value;
+        eventfd_read(reactor.wakeupFd, &value);
+        if (finished)
+        {
+            armReactorOp(reactor, UringOp::WAKEUP);
+        }
+        break;
+    }
+    case UringOp::RECV: {
+        if (finished)
+        {
+            data->recvArmed = false;
+            --data->pendingOps;
+        }
+
+        // Copy the bytes out and give the buffer straight back to the kernel
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+        {
+            uint16_t bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            if (cqe.res > 0 && !data->closing)
+            {
+                data->readBuffer.append(reactor.ring->buffer(bufferId), cqe.res);
+            }
+            reactor.ring->recycleBuffer(bufferId);
+        }
+
+        // Closed connection, free it once its last request has completed
+        if (data->closing)
+        {
+            if (data->pendingOps == 0)
+            {
+                releaseConnection(data);
+            }
+            break;
+        }
+
+        if (cqe.res > 0)
+        {
+            // Update last active time and queue the connection for frame parsing
+            data->lastActiveTime = std::chrono::steady_clock::now();
+            if (!data->inReadyList)
+            {
+                data->inReadyList = true;
+                reactor.readyList.push_back(data);
+            }
+            LOG_DEBUG(networkLogger, "Received " + std::to_string(cqe.res) + " bytes from " + peerName(data));
+        }
+        else if (cqe.res == 0)
+        {
+            LOG_ERROR(networkLogger, "Connection closed by peer");
+            closeConnection(data);
+            break;
+        }
+        else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+        {
+            LOG_ERROR(networkLogger, "Error reading from socket: " + std::string(strerror(-cqe.res)));
+            closeConnection(data);
+            break;
+        }
+
+        // Multishot recv ended, e.g. because the buffer ring ran dry: re-arm it unless reading is paused
+        if (finished && !data->readPaused)
+        {
+            if (!reactor.ring->prepRecv(data->fd, uringUserData(data, UringOp::RECV)))
+            {
+                LOG_ERROR(networkLogger, "No io_uring submission entry to receive from " + peerName(data));
+                closeConnection(data);
+                break;
+            }
+            data->recvArmed = true;
+            ++data->pendingOps;
+        }
+        break;
+    }
+    case UringOp::SEND_READY: {
+        --data->pendingOps;
+        if (data->closing)
+        {
+            if (data->pendingOps == 0)
+            {
+                releaseConnection(data);
+            }
+            break;
+        }
+
+        // Socket is writable again, send the queue with the next submission
+        queueUringSend(data);
+        break;
+    }
+    case UringOp::SEND: {
+        --data->pendingOps;
+        reactor.freeSends.push_back(std::move(data->send));
+        if (data->closing)
+        {
+            if (data->pendingOps == 0)
+            {
+                releaseConnection(data);
+            }
+            break;
+        }
+
+        if (cqe.res == -EAGAIN)
+        {
+            // Nothing was written, wait for the socket before sending again
+            armWrite(data);
+            break;
+        }
+        if (cqe.res < 0)
+        {
+            LOG_ERROR(networkLogger, "Error writing to socket: " + std::string(strerror(-cqe.res)));
+            closeConnection(data);
+            break;
+        }
+
+        // A short send leaves the rest at the front of the queue for the next one
+        data->writeQueue.consume(cqe.res);
+        if (data->readPaused && data->writeQueue.queuedBytes() <= m_writeLowWatermark && !resumeReading(data))
+        {
+            break;
+        }
+        if (!data->writeQueue.empty())
+        {
+            queueUringSend(data);
+        }
+        break;
+    }
+    }
+}
@@ -0,0 +1,116 @@
+#include "outputQueue.h"
+
+#include <arpa/inet.h>
+#include <cstring>
+
+void OutputQueue::push(MsgType msgType, SharedPayload body)
+{
+    // Encode header (type + length) in network byte order
+    Frame    frame;
+    uint16_t typeVal = htons(static_cast<uint16_t>(msgType));
+    uint32_t msgLen  = htonl(static_cast<uint32_t>(body->size()));
+    std::memcpy(frame.header, &typeVal, sizeof(typeVal));
+    std::memcpy(frame.header + sizeof(typeVal), &msgLen, sizeof(msgLen));
+    frame.body = std::move(body);
+
+    m_queuedBytes += sizeof(frame.header) + frame.body->size();
+    m_frames.push_back(std::move(frame));
+}
+
+void OutputQueue::clear()
+{
+    m_frames.clear();
+    m_head        = 0;
+    m_frontOffset = 0;
+    m_queuedBytes = 0;
+}
+
+void OutputQueue::release()
+{
+    clear();
+    std::vector<Frame>().swap(m_frames);
+}
+
+ssize_t OutputQueue::writeFd(int fd)
+{
+    if (empty())
+    {
+        return 0;
+    }
+
+    struct iovec vec[kMaxIovecs];
+    ssize_t      n = writev(fd, vec, gather(vec));
+    if (n > 0)
+    {
+        consume(n);
+    }
+    return n;
+}
+
+int OutputQueue::gather(iovec *vec, char (*headerCopy)[kHeaderSize])
+{
+    // Gather header and body of each frame, skipping what the front frame already wrote
+    int    iovcnt = 0;
+    size_t skip   = m_frontOffset;
+    for (size_t i = m_head; i < m_frames.size() && i < m_head + kMaxFramesPerWrite; ++i)
+    {
+        Frame &frame = m_frames[i];
+        if (skip < sizeof(frame.header))
+        {
+            char *header = frame.header;
+            if (headerCopy)
+            {
+                header = headerCopy[i - m_head];
+                std::memcpy(header, frame.header, sizeof(frame.header));
+            }
+            vec[iovcnt].iov_base = header + skip;
+            vec[iovcnt].iov_len  = sizeof(frame.header) - skip;
+            ++iovcnt;
+            skip = 0;
+        }
+        else
+        {
+            skip -= sizeof(frame.header);
+        }
+        if (skip < frame.body->size())
+        {
+            vec[iovcnt].iov_base = const_cast<char *>(frame.body->data() + skip);
+            vec[iovcnt].iov_len  = frame.body->size() - skip;
+            ++iovcnt;
+        }
+        skip = 0;
+    }
+    return iovcnt;
+}
+
+void OutputQueue::consume(size_t n)
+{
+    // Drop fully written frames and remember how far into the next one we got
+    m_queuedBytes -= n;
+    size_t written = m_frontOffset + n;
+    while (!empty())
+    {
+        Frame &frame     = m_frames[m_head];
+        size_t frameSize = sizeof(frame.header) + frame.body->size();
+        if (written < frameSize)
+        {
+            break;
+        }
+        written -= frameSize;
+        frame.body.reset();
+        ++m_head;
+    }
+    m_frontOffset = written;
+
+    // Start over at the front once everything is out, or once the sent frames are most of the vector
+    if (empty())
+    {
+        m_frames.clear();
+        m_head = 0;
+    }
+    else if (m_head >= kMaxFramesPerWrite && m_head * 2 >= m_frames.size())
+    {
+        m_frames.erase(m_frames.begin(), m_frames.begin() + m_head);
+        m_head = 0;
+    }
+}
@@ -0,0 +1,67 @@
+#include "rateLimiter.h"
+
+#include <algorithm>
+#include <bit>
+
+RateLimiter::RateLimiter(double ratePerSecond, double burst, size_t shardCount, std::chrono::seconds idleTimeout)
+    : m_ratePerSecond(ratePerSecond), m_burst(burst), m_shardMask(std::bit_ceil(std::max<size_t>(1, shardCount)) - 1),
+      m_idleTimeout(idleTimeout), m_shards(std::make_unique<Shard[]>(m_shardMask + 1))
+{
+}
+
+void RateLimiter::configure(double ratePerSecond, double burst)
+{
+    m_ratePerSecond = ratePerSecond;
+    m_burst         = burst;
+}
+
+bool RateLimiter::tryAcquire(uint32_t address, std::chrono::steady_clock::time_point now)
+{
+    // Peers of one subnet differ in the low bits, mix them all into the shard index
+    Shard                      &shard = m_shards[(address * 0x9E3779B1u) >> 16 & m_shardMask];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (now >= shard.nextSweep)
+    {
+        sweep(shard, now);
+    }
+
+    // New peers start with a full bucket
+    auto [it, inserted] = shard.buckets.try_emplace(address, Bucket{m_burst, now});
+    Bucket &bucket      = it->second;
+    if (!inserted && now > bucket.lastRefill)
+    {
+        // Callers read the clock before taking the lock, so now can trail the last refill. Such a call
+        // refills nothing and must not move lastRefill back, or the next caller is credited twice.
+        std::chrono::duration<double> elapsed = now - bucket.lastRefill;
+        bucket.tokens     = std::min(m_burst, bucket.tokens + elapsed.count() * m_ratePerSecond);
+        bucket.lastRefill = now;
+    }
+
+    if (bucket.tokens < 1.0)
+    {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+size_t RateLimiter::size() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i <= m_shardMask; ++i)
+    {
+        std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+        total += m_shards[i].buckets.size();
+    }
+    return total;
+}
+
+void RateLimiter::sweep(Shard &shard, std::chrono::steady_clock::time_point now)
+{
+    // A full bucket behaves exactly like a new one, forgetting it is free
+    std::chrono::duration<double> refillTime(m_burst / m_ratePerSecond);
+    std::chrono::duration<double> idleTime = std::max<std::chrono::duration<double>>(m_idleTimeout, refillTime);
+    std::erase_if(shard.buckets, [&](const auto &entry) { return now - entry.second.lastRefill >= idleTime; });
+    shard.nextSweep = now + m_idleTimeout;
+}
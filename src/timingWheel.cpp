@@ -0,0 +1,110 @@
+#include "timingWheel.h"
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, size_t slotCount)
+    : m_startTime(std::chrono::steady_clock::now()), m_tick(tick), m_slots(slotCount, nullptr)
+{
+}
+
+void TimingWheel::schedule(TimerNode *node, std::chrono::steady_clock::time_point deadline)
+{
+    // Re-arming an already scheduled node moves it to its new slot
+    if (node->timerArmed)
+    {
+        unlink(node);
+    }
+
+    // Never schedule into a tick that has already been processed
+    uint64_t tick    = toTick(deadline);
+    node->expireTick = tick > m_currentTick ? tick : m_currentTick + 1;
+    link(node);
+}
+
+void TimingWheel::cancel(TimerNode *node)
+{
+    if (node->timerArmed)
+    {
+        unlink(node);
+    }
+}
+
+void TimingWheel::advance(std::chrono::steady_clock::time_point now, const std::function<void(TimerNode *)> &onExpire)
+{
+    uint64_t nowTick = toTick(now);
+    if (nowTick <= m_currentTick)
+    {
+        return;
+    }
+
+    // Visit each elapsed slot once, a full revolution at most, and collect the due nodes
+    uint64_t elapsed = nowTick - m_currentTick;
+    uint64_t visits  = elapsed < m_slots.size() ? elapsed : m_slots.size();
+    for (uint64_t i = 1; i <= visits; ++i)
+    {
+        TimerNode *node = m_slots[(m_currentTick + i) % m_slots.size()];
+        while (node)
+        {
+            TimerNode *next = node->timerNext;
+            if (node->expireTick <= nowTick)
+            {
+                unlink(node);
+                m_expired.push_back(node);
+            }
+            node = next;
+        }
+    }
+    m_currentTick = nowTick;
+
+    // Callbacks run after the sweep so they can safely re-schedule or destroy their node
+    std::vector<TimerNode *> expired;
+    expired.swap(m_expired);
+    for (TimerNode *node : expired)
+    {
+        onExpire(node);
+    }
+    expired.clear();
+    m_expired.swap(expired);
+}
+
+uint64_t TimingWheel::toTick(std::chrono::steady_clock::time_point time) const
+{
+    if (time <= m_startTime)
+    {
+        return 0;
+    }
+
+    // Round up, a node must not fire before its deadline
+    auto sinceStart = std::chrono::duration_cast<std::chrono::milliseconds>(time - m_startTime);
+    return (sinceStart.count() + m_tick.count() - 1) / m_tick.count();
+}
+
+void TimingWheel::link(TimerNode *node)
+{
+    TimerNode *&head = m_slots[node->expireTick % m_slots.size()];
+    node->timerPrev  = nullptr;
+    node->timerNext  = head;
+    if (head)
+    {
+        head->timerPrev = node;
+    }
+    head             = node;
+    node->timerArmed = true;
+}
+
+void TimingWheel::unlink(TimerNode *node)
+{
+    if (node->timerPrev)
+    {
+        node->timerPrev->timerNext = node->timerNext;
+    }
+    else
+    {
+        m_slots[node->expireTick % m_slots.size()] = node->timerNext;
+    }
+    if (node->timerNext)
+    {
+        node->timerNext->timerPrev = node->timerPrev;
+    }
+    node->timerPrev  = nullptr;
+    node->timerNext  = nullptr;
+    node->timerArmed = false;
+}
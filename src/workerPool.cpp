@@ -0,0 +1,273 @@
+#include "workerPool.h"
+#include "logManager.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::throwIfStarted(const char *what) const
+{
+    // Workers and submitters read the configuration without locking once they run
+    if (!m_workers.empty())
+    {
+        std::string message = std::string(what) + " cannot be changed after start";
+        LOG_ERROR(logger, message);
+        throw std::runtime_error(message);
+    }
+}
+
+void WorkerPool::setDispatchMode(DispatchMode mode)
+{
+    throwIfStarted("Dispatch mode");
+    m_mode = mode;
+}
+
+void WorkerPool::setPriorityWeights(const std::array<unsigned, kPriorityCount> &weights)
+{
+    throwIfStarted("Priority weights");
+    m_weights = weights;
+}
+
+void WorkerPool::start(size_t workerCount, Handler handler)
+{
+    m_handler = std::move(handler);
+
+    // Create all deques before any thread may try to steal from them
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        m_workers[i]->thread = std::thread([this, i]() { run(i); });
+    }
+}
+
+void WorkerPool::stop()
+{
+    // Wake every worker, each drains its own deque before exiting
+    for (auto &worker : m_workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        m_stop = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_stop = true;
+    }
+    for (auto &worker : m_workers)
+    {
+        worker->condition.notify_all();
+    }
+    m_idleCondition.notify_all();
+    for (auto &worker : m_workers)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+void WorkerPool::submit(Task task)
+{
+    // Only the chosen worker's lock is taken, submitters on different reactors rarely collide
+    Worker &worker   = m_mode == DispatchMode::CLIENT_AFFINE
+                           ? affineWorker(task.clientID)
+                           : *m_workers[m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size()];
+    task.priority    = std::min<uint8_t>(task.priority, kPriorityCount - 1);
+    task.enqueueTime = std::chrono::steady_clock::now();
+    m_counters[task.priority].queued.fetch_add(1, std::memory_order_relaxed);
+
+    // Pinned tasks keep arrival order, so they skip the priority deques
+    size_t deque = m_mode == DispatchMode::CLIENT_AFFINE ? 0 : task.priority;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks[deque].push_back(std::move(task));
+        ++worker.taskCount;
+        // Counted under the lock takeNext() uses, so the count never drops below zero
+        m_queuedTasks.fetch_add(1);
+    }
+
+    if (m_mode == DispatchMode::CLIENT_AFFINE)
+    {
+        worker.condition.notify_one();
+    }
+    else if (m_idleWorkers.load() > 0)
+    {
+        // The chosen worker may be stuck in a slow handler, wake any sleeper to take the task. Taking the
+        // lock orders this with a sleeper that has counted itself idle but not started waiting yet.
+        {
+            std::lock_guard<std::mutex> lock(m_idleMutex);
+        }
+        m_idleCondition.notify_one();
+    }
+}
+
+void WorkerPool::post(const ClientID &clientID, uint8_t priority, std::function<void()> job)
+{
+    submit({clientID, MsgType::SYSTEM, std::string(), std::move(job), priority, {}});
+}
+
+void WorkerPool::holdClient(const ClientID &clientID)
+{
+    if (m_mode != DispatchMode::CLIENT_AFFINE)
+    {
+        return;
+    }
+    Worker                     &worker = affineWorker(clientID);
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.held.try_emplace(clientID);
+}
+
+void WorkerPool::releaseClient(const ClientID &clientID)
+{
+    if (m_mode != DispatchMode::CLIENT_AFFINE)
+    {
+        return;
+    }
+    Worker &worker = affineWorker(clientID);
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto                        held = worker.held.find(clientID);
+        if (held == worker.held.end())
+        {
+            return;
+        }
+        // Messages set aside arrived before anything still queued for this client, so they go in front
+        std::deque<Task> &tasks = worker.tasks[0];
+        tasks.insert(tasks.begin(), std::make_move_iterator(held->second.begin()),
+                     std::make_move_iterator(held->second.end()));
+        worker.taskCount += held->second.size();
+        worker.held.erase(held);
+    }
+    worker.condition.notify_one();
+}
+
+WorkerPool::PriorityStats WorkerPool::priorityStats(uint8_t priority) const
+{
+    const Counters &counters = m_counters[std::min<uint8_t>(priority, kPriorityCount - 1)];
+    return {counters.queued.load(std::memory_order_relaxed), counters.handled.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(counters.waitNanos.load(std::memory_order_relaxed))};
+}
+
+WorkerPool::Worker &WorkerPool::affineWorker(const ClientID &clientID)
+{
+    return *m_workers[std::hash<ClientID>()(clientID) % m_workers.size()];
+}
+
+void WorkerPool::run(size_t index)
+{
+    Worker &self = *m_workers[index];
+    while (true)
+    {
+        // Own deque first, then help the others unless tasks are pinned to their worker
+        Task task;
+        if (popLocal(index, task) || (m_mode == DispatchMode::WORK_STEALING && steal(index, task)))
+        {
+            Counters &counters = m_counters[task.priority];
+            counters.handled.fetch_add(1, std::memory_order_relaxed);
+            counters.waitNanos.fetch_add(
+                std::chrono::nanoseconds(std::chrono::steady_clock::now() - task.enqueueTime).count(),
+                std::memory_order_relaxed);
+            task.job ? task.job() : m_handler(task);
+            continue;
+        }
+
+        // Nothing to do anywhere, sleep until a task is submitted to any worker
+        if (m_mode == DispatchMode::WORK_STEALING)
+        {
+            std::unique_lock<std::mutex> lock(m_idleMutex);
+            ++m_idleWorkers;
+            m_idleCondition.wait(lock, [this] { return m_stop || m_queuedTasks.load() > 0; });
+            --m_idleWorkers;
+            if (m_stop && m_queuedTasks.load() == 0) return;
+            continue;
+        }
+
+        // Pinned tasks only ever come from this worker's own deque
+        std::unique_lock<std::mutex> lock(self.mutex);
+        self.condition.wait(lock, [this, &self] { return m_stop || self.taskCount > 0; });
+        if (m_stop && self.taskCount == 0) return;
+    }
+}
+
+bool WorkerPool::popLocal(size_t index, Task &task)
+{
+    Worker                     &self = *m_workers[index];
+    std::lock_guard<std::mutex> lock(self.mutex);
+    return takeNext(self, task);
+}
+
+bool WorkerPool::steal(size_t index, Task &task)
+{
+    // Serve a busy worker's deques in the order it would itself
+    for (size_t i = 1; i < m_workers.size(); ++i)
+    {
+        Worker                      &victim = *m_workers[(index + i) % m_workers.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (lock.owns_lock() && takeNext(victim, task))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkerPool::takeNext(Worker &worker, Task &task)
+{
+    // Messages of held clients are set aside until released, they still count as queued meanwhile
+    std::deque<Task> &pinned = worker.tasks[0];
+    while (!worker.held.empty() && !pinned.empty() && !pinned.front().job)
+    {
+        auto held = worker.held.find(pinned.front().clientID);
+        if (held == worker.held.end())
+        {
+            break;
+        }
+        held->second.push_back(std::move(pinned.front()));
+        pinned.pop_front();
+        --worker.taskCount;
+    }
+
+    // Smooth weighted round-robin: every non-empty deque earns its weight, the richest one pays the
+    // total and is served. Each gets its weight share of the picks, interleaved rather than in bursts.
+    size_t  next  = kPriorityCount;
+    int64_t total = 0;
+    for (size_t i = kPriorityCount; i-- > 0;)
+    {
+        if (worker.tasks[i].empty())
+        {
+            continue;
+        }
+        int64_t weight = std::max(1u, m_weights[i]);
+        worker.credits[i] += weight;
+        total += weight;
+        if (next == kPriorityCount || worker.credits[i] > worker.credits[next])
+        {
+            next = i;
+        }
+    }
+    if (next == kPriorityCount)
+    {
+        return false;
+    }
+    worker.credits[next] -= total;
+
+    std::deque<Task> &tasks = worker.tasks[next];
+    task                    = std::move(tasks.front());
+    tasks.pop_front();
+    --worker.taskCount;
+    // A deque that ran dry starts from scratch next time, instead of with what it earned or owed
+    if (tasks.empty())
+    {
+        worker.credits[next] = 0;
+    }
+    m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    m_counters[task.priority].queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
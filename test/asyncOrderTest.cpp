@@ -0,0 +1,67 @@
+// One client sends two login requests back to back and the handler of the first one suspends for a while.
+// In CLIENT_AFFINE mode the second request must wait for it, so the replies come back in request order.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "asyncTask.h"
+#include "msg.pb.h"
+#include "networkManager.h"
+#include "testClient.h"
+
+static constexpr uint16_t kPort = 17701;
+
+static AsyncTask<void> EchoLogin(ClientID, const msg::LoginRequest &loginReq, msg::LoginResponse &loginResp)
+{
+    // The first request would be answered after the second one if nothing held the client
+    if (loginReq.username() == "first")
+    {
+        co_await sleepFor(std::chrono::milliseconds(100));
+    }
+    loginResp.set_session_id(loginReq.username());
+}
+
+int main()
+{
+    NetworkManager *networkManager = NetworkManager::instance();
+    networkManager->setReactorCount(1);
+    networkManager->setMaxWorkerThreads(2);
+    networkManager->setDispatchMode(WorkerPool::DispatchMode::CLIENT_AFFINE);
+    networkManager->registerAsyncHandler<msg::LoginRequest, msg::LoginResponse>(MsgType::LOGIN_REQUEST,
+                                                                                MsgType::LOGIN_RESPONSE, EchoLogin);
+    std::thread([networkManager] { networkManager->start(kPort); }).detach();
+
+    TestClient client(kPort);
+    for (const char *username : {"first", "second"})
+    {
+        msg::LoginRequest loginReq;
+        loginReq.set_username(username);
+        client.send(MsgType::LOGIN_REQUEST, loginReq.SerializeAsString());
+    }
+
+    int failures = 0;
+    for (const char *expected : {"first", "second"})
+    {
+        MsgType            msgType;
+        std::string        body;
+        msg::LoginResponse loginResp;
+        if (!client.receive(msgType, body) || msgType != MsgType::LOGIN_RESPONSE || !loginResp.ParseFromString(body))
+        {
+            std::fprintf(stderr, "FAIL: no login response for %s\n", expected);
+            ++failures;
+            break;
+        }
+        if (loginResp.session_id() != expected)
+        {
+            std::fprintf(stderr, "FAIL: expected reply to %s, got %s\n", expected, loginResp.session_id().c_str());
+            ++failures;
+        }
+    }
+
+    // Reactors run until the process exits
+    std::fflush(stderr);
+    std::_Exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,58 @@
+// A default ClientID{0} never names a connection. A closed connection's slot keeps its old fd and a reset
+// ClientID, so if the empty handle matched it, a message to ClientID{0} would be written to whichever new
+// connection reuses that fd.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "networkManager.h"
+#include "testClient.h"
+
+static constexpr uint16_t kPort = 17702;
+
+int main()
+{
+    NetworkManager *networkManager = NetworkManager::instance();
+    networkManager->setReactorCount(1);
+    networkManager->setMaxWorkerThreads(1);
+    std::thread([networkManager] { networkManager->start(kPort); }).detach();
+
+    // Slots 0 to 2, then free slot 0 and slot 1: the next connection gets slot 1 and slot 0's old fd
+    auto first  = std::make_unique<TestClient>(kPort);
+    auto second = std::make_unique<TestClient>(kPort);
+    TestClient third(kPort);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    first.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    second.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TestClient client(kPort);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Must go nowhere, then the client's own ping is the first thing answered
+    SendMessage(ClientID(), MsgType::HEARTBEAT, std::string("stray"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    client.send(MsgType::HEARTBEAT, "ping");
+
+    int         failures = 0;
+    MsgType     msgType;
+    std::string body;
+    if (!client.receive(msgType, body))
+    {
+        std::fprintf(stderr, "FAIL: no pong\n");
+        ++failures;
+    }
+    else if (msgType != MsgType::HEARTBEAT || body != "pong")
+    {
+        std::fprintf(stderr, "FAIL: got \"%s\" before the pong\n", body.c_str());
+        ++failures;
+    }
+
+    // Reactors run until the process exits
+    std::fflush(stderr);
+    std::_Exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
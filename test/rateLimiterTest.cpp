@@ -0,0 +1,43 @@
+// Reactors read the clock before they take the shard lock, so a bucket can see a now earlier than its last
+// refill. Such a call refills nothing: it neither takes tokens back nor moves the refill time backwards,
+// which would credit that interval to the next caller a second time.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "rateLimiter.h"
+
+int main()
+{
+    using namespace std::chrono_literals;
+
+    RateLimiter                           limiter(1, 2);
+    constexpr uint32_t                    kAddress = 0x7F000001;
+    std::chrono::steady_clock::time_point start    = std::chrono::steady_clock::now();
+
+    struct Step
+    {
+        std::chrono::milliseconds offset;
+        bool                      expected;
+        const char               *what;
+    };
+    const Step steps[] = {
+        {0ms, true, "first of the burst"},
+        {-500ms, true, "second of the burst from a stale clock"},
+        {500ms, false, "half a token refilled since the first"},
+        {1000ms, true, "one token refilled since the first"},
+    };
+
+    int failures = 0;
+    for (const Step &step : steps)
+    {
+        if (limiter.tryAcquire(kAddress, start + step.offset) != step.expected)
+        {
+            std::fprintf(stderr, "FAIL: %s at %+lld ms was %s\n", step.what,
+                         static_cast<long long>(step.offset.count()), step.expected ? "refused" : "admitted");
+            ++failures;
+        }
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,134 @@
+#ifndef TEST_CLIENT_H
+#define TEST_CLIENT_H
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "networkMsg.h"
+
+// Blocking client speaking the server's frame format, for tests against a NetworkManager on localhost
+class TestClient
+{
+  public:
+    // Retries until the server listens, tests start it on another thread
+    explicit TestClient(uint16_t port)
+    {
+        sockaddr_in serverAddr{};
+        serverAddr.sin_family      = AF_INET;
+        serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        serverAddr.sin_port        = htons(port);
+        for (int attempt = 0; attempt < 100; ++attempt)
+        {
+            m_fd = moveAboveServerFds(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+            if (m_fd != -1 && connect(m_fd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) == 0)
+            {
+                return;
+            }
+            close(m_fd);
+            m_fd = -1;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        throw std::runtime_error("Failed to connect to test server");
+    }
+    ~TestClient()
+    {
+        if (m_fd != -1)
+        {
+            close(m_fd);
+        }
+    }
+
+    TestClient(const TestClient &)            = delete;
+    TestClient &operator=(const TestClient &) = delete;
+
+    void send(MsgType msgType, const std::string &body)
+    {
+        // Big-endian u16 type and u32 body length, then the body
+        uint16_t    type   = htons(static_cast<uint16_t>(msgType));
+        uint32_t    length = htonl(static_cast<uint32_t>(body.size()));
+        std::string frame(sizeof(type) + sizeof(length), '\0');
+        std::memcpy(&frame[0], &type, sizeof(type));
+        std::memcpy(&frame[sizeof(type)], &length, sizeof(length));
+        frame += body;
+
+        for (size_t sent = 0; sent < frame.size();)
+        {
+            ssize_t n = ::send(m_fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                throw std::runtime_error("Failed to send to test server");
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // False on timeout or once the server closed the connection
+    bool receive(MsgType &msgType, std::string &body, std::chrono::milliseconds timeout = std::chrono::seconds(5))
+    {
+        auto     deadline = std::chrono::steady_clock::now() + timeout;
+        uint16_t type;
+        uint32_t length;
+        char     header[sizeof(type) + sizeof(length)];
+        if (!receiveExactly(header, sizeof(header), deadline))
+        {
+            return false;
+        }
+        std::memcpy(&type, header, sizeof(type));
+        std::memcpy(&length, header + sizeof(type), sizeof(length));
+
+        msgType = static_cast<MsgType>(ntohs(type));
+        body.resize(ntohl(length));
+        return body.empty() || receiveExactly(&body[0], body.size(), deadline);
+    }
+
+  private:
+    // Server and client share the process, so fd numbers the server frees are not taken by test clients
+    static int moveAboveServerFds(int fd)
+    {
+        if (fd == -1)
+        {
+            return -1;
+        }
+        int movedFd = fcntl(fd, F_DUPFD_CLOEXEC, kMinClientFd);
+        close(fd);
+        return movedFd;
+    }
+
+    bool receiveExactly(char *buffer, size_t size, std::chrono::steady_clock::time_point deadline)
+    {
+        for (size_t received = 0; received < size;)
+        {
+            auto   left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                                                                              std::chrono::steady_clock::now());
+            pollfd pfd{m_fd, POLLIN, 0};
+            if (left.count() <= 0 || poll(&pfd, 1, static_cast<int>(left.count())) <= 0)
+            {
+                return false;
+            }
+            ssize_t n = recv(m_fd, buffer + received, size - received, 0);
+            if (n <= 0)
+            {
+                return false;
+            }
+            received += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+  private:
+    static constexpr int kMinClientFd = 512;
+
+    int m_fd = -1;
+};
+
+#endif // TEST_CLIENT_H
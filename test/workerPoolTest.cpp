@@ -0,0 +1,45 @@
+// A task queued behind a slow handler in WORK_STEALING mode is taken by the idle worker, which has to be
+// woken for it rather than sleep until its own deque gets something.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "workerPool.h"
+
+int main()
+{
+    using Clock = std::chrono::steady_clock;
+
+    WorkerPool pool;
+    pool.start(2, [](WorkerPool::Task &) {});
+
+    // Round-robin puts the slow task and the last one on the same worker, the other idles after the quick one
+    std::atomic<bool>       done{false};
+    std::atomic<Clock::rep> finishedAt{0};
+    pool.post(ClientID(), 0, [] { std::this_thread::sleep_for(std::chrono::milliseconds(500)); });
+    pool.post(ClientID(), 0, [] {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    Clock::time_point start = Clock::now();
+    pool.post(ClientID(), 0, [&] {
+        finishedAt = (Clock::now() - start).count();
+        done       = true;
+    });
+    while (!done)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pool.stop();
+
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::duration(finishedAt.load()));
+    if (waited > std::chrono::milliseconds(200))
+    {
+        std::fprintf(stderr, "FAIL: task waited %lld ms behind the slow one\n",
+                     static_cast<long long>(waited.count()));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}